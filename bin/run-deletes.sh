@@ -15,7 +15,7 @@ export TIME="%C,%E,%M"
 for selfadjust in "" "-self-adjust"
 do 
     #test each implementation
-    for imp in "-nop" "-map" "-treap" "-hashtable" "-skiplist" "-splaytree"
+    for imp in "-nop" "-map" "-treap" "-top-down-treap" "-hashtable" "-open-hashtable" "-group-hashtable" "-skiplist" "-deterministic-skiplist" "-splaytree"
     do
         echo "testing: $imp"
 
@@ -19,7 +19,7 @@ for zipf in "0" "0.5" "1" "1.5"
 do
     echo "zipf s: $zipf"
 
-    for size in "5000" "10000" "15000" "20000" 
+    for size in "100" "1000" "5000" "10000" "15000" "20000" 
     do 
         #run test and record to log file 
         for i in 1 2 3 4 5 6 7 8 9 10
@@ -16,7 +16,7 @@ do
     do
 
         #test each implementation
-        for imp in "-nop" "-map" "-treap" "-hashtable" "-skiplist" "-splaytree"
+        for imp in "-nop" "-map" "-treap" "-top-down-treap" "-hashtable" "-open-hashtable" "-group-hashtable" "-skiplist" "-deterministic-skiplist" "-splaytree"
         do
             echo "testing: $imp" 
             valgrind --tool=cachegrind --branch-sim=yes --cachegrind-out-file=/dev/null ./search $imp $testdir/i$nwords.txt $selfadjust -size=$nwords 2>> $outfile 
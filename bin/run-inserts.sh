@@ -18,7 +18,7 @@ do
     do
 
         #test each implementation
-        for imp in "-nop" "-map" "-treap" "-hashtable" "-skiplist" "-splaytree"
+        for imp in "-nop" "-map" "-treap" "-top-down-treap" "-hashtable" "-open-hashtable" "-group-hashtable" "-skiplist" "-deterministic-skiplist" "-splaytree"
         do
             echo "testing: $imp"
 
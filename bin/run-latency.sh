@@ -0,0 +1,32 @@
+#!/bin/bash
+
+#check for command line
+if [ -z "$1" ]; then
+    echo "usage: $0 testsize"
+    exit
+fi
+
+#config variables
+nwords=$1
+testdir="../tests/data" 
+
+outfile="results-latency-$nwords"
+
+if [ -e $outfile ]; then
+    rm $outfile
+fi
+
+#compare the lookup time percentiles of the randomized and deterministic
+#skip lists at each bias level
+for zipf in "0" "0.5" "1" "1.5"
+do
+    for imp in "-skiplist" "-deterministic-skiplist"
+    do
+        echo "zipf s: $zipf $imp" | tee -a $outfile
+
+        for i in 1 2 3 4 5
+        do
+            ./search $imp "$testdir/s$nwords-500000-z$zipf.txt" -latency -size=$nwords | tail -n 1 >> $outfile
+        done
+    done
+done
@@ -0,0 +1,36 @@
+#!/bin/bash
+
+#check for command line
+if [ -z "$1" ]; then
+    echo "usage: $0 testsize [threads]"
+    exit
+fi
+
+#config variables
+nwords=$1
+threads=${2:-`nproc`}
+testdir="../tests/data" 
+
+outfile="results-threads-$nwords"
+
+if [ -e $outfile ]; then
+    rm $outfile
+fi
+
+#test each bias level
+for zipf in "0" "0.5" "1" "1.5"
+do
+    for selfadjust in "" "-self-adjust"
+    do 
+        for imp in "-concurrent-hashtable" "-concurrent-skiplist"
+        do
+            #the skiplist has no self-adjusting mode
+            if [ "$imp" == "-concurrent-skiplist" ] && [ -n "$selfadjust" ]; then
+                continue
+            fi
+
+            echo "zipf s: $zipf $imp $selfadjust" | tee -a $outfile
+            ./search $imp "$testdir/s$nwords-500000-z$zipf.txt" $selfadjust -size=$nwords -threads=$threads >> $outfile
+        done
+    done
+done
@@ -23,67 +23,81 @@ THE SOFTWARE.
 #ifndef BIASED_HASHTABLE_H_
 #define BIASED_HASHTABLE_H_
 
-template<class K, class V> class BiasedHashtable {
+#include <algorithm>
+#include <stdexcept>
 
-public:
+#include "key_hash.h"
+#include "slab_allocator.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-    typedef unsigned int (*HashFunction)(const K &key);
+template<class K, class V, class Hash = KeyHash, template<class> class Allocator = SlabAllocator> class BiasedHashtable {
 
-    BiasedHashtable(size_t initial_size, HashFunction hash) : count(0), size(initial_size), hash(hash)
+public:
+
+    BiasedHashtable(size_t initial_size, Hash hash = Hash(), float max_load = 1.0f) : count(0), size(initial_size), hash(hash), max_load(max_load), old_nodes(0), old_size(0), migrated(0)
     {
+        if (size == 0) size = 1;
         nodes = new Node[size]; 
     } 
 
     virtual ~BiasedHashtable()
     {
-        for (size_t i = 0; i < size; ++i) {
-            Node *n = nodes[i].next;
-            while(n) {
-                Node *t = n;
-                n = n->next;
-                delete t;
-            }
-        }
-
-        delete[] nodes; 
+        free_table(nodes, size);
+        if (old_nodes) free_table(old_nodes, old_size);
     }
 
     void insert(const K &key, const V &value, size_t weight)
     {
-        size_t index = hash(key) % size;
-        if (!nodes[index].stored) {
+        //grow once the load factor is exceeded, otherwise continue any migration in progress
+        if ((float)(count + 1) > max_load * (float)size) {
+            grow();
+        } else {
+            migrate_step();
+        }
+
+        unsigned int h = hash(key);
+        Node *head = bucket(h);
+        if (!head->stored) {
             //just insert node if no collision
-            nodes[index].key = key;
-            nodes[index].value = value;
-            nodes[index].weight = weight;
-            nodes[index].stored = true;
+            head->key = key;
+            head->value = value;
+            head->weight = weight;
+            head->hash_value = h;
+            head->stored = true;
         } else {
 
             //find place to insert node in list
-            Node *n = &nodes[index];
+            Node *n = head;
             while(n->next && n->next->weight > weight) n = n->next;
 
             //create node and insert
             Node *t = n->next;
-            n->next = new Node;
+            n->next = pool.allocate();
             n->next->key = key;
             n->next->value = value;
             n->next->weight = weight;
+            n->next->hash_value = h;
             n->next->next = t;
         } 
 
         ++count;
     } 
 
-    V *find(const K &key)
+    //Q can be any type the hash accepts and which compares equal to K
+    template<class Q> V *find(const Q &key)
     {
+        migrate_step();
+
         V *result = 0; 
-        size_t index = hash(key) % size;
-        if (nodes[index].stored) {
-            Node *p = 0; 
-            Node *n = &nodes[index];
-            while (n && n->key != key) {
-                p = n;
+        unsigned int h = hash(key);
+        Node *head = bucket(h);
+        if (head->stored) {
+            //compare cached hashes before keys
+            Node *n = head;
+            while (n && (n->hash_value != h || n->key != key)) {
                 n = n->next;
             }
 
@@ -95,13 +109,50 @@ public:
         return result;
     }
 
-    void remove(const K &key)
+    //look up n keys at once, storing a pointer to each value or 0 in results.
+    //all bucket heads and first chain nodes are prefetched before any key
+    //is compared so the cache misses overlap
+    template<class Q> void find_batch(const Q *keys, size_t n, V **results)
+    {
+        unsigned int hashes[PREFETCH_BATCH];
+        Node *heads[PREFETCH_BATCH];
+
+        //do the resizing work of all the finds up front, so nodes stay put
+        //and the results remain valid for the whole batch
+        for (size_t i = 0; i < n; ++i) migrate_step();
+
+        for (size_t begin = 0; begin < n; begin += PREFETCH_BATCH) {
+            size_t end = begin + PREFETCH_BATCH < n ? begin + PREFETCH_BATCH : n;
+
+            for (size_t i = begin; i < end; ++i) {
+                hashes[i - begin] = hash(keys[i]);
+                heads[i - begin] = bucket(hashes[i - begin]);
+                __builtin_prefetch(heads[i - begin]);
+            }
+
+            for (size_t i = begin; i < end; ++i) {
+                if (heads[i - begin]->next) __builtin_prefetch(heads[i - begin]->next);
+            }
+
+            for (size_t i = begin; i < end; ++i) {
+                unsigned int h = hashes[i - begin];
+                Node *n = heads[i - begin]->stored ? heads[i - begin] : 0;
+                while (n && (n->hash_value != h || n->key != keys[i])) n = n->next;
+                results[i] = n ? &n->value : 0;
+            }
+        }
+    }
+
+    template<class Q> void remove(const Q &key)
     { 
-        size_t index = hash(key) % size;
-        if (nodes[index].stored) {
+        migrate_step();
+
+        unsigned int h = hash(key);
+        Node *head = bucket(h);
+        if (head->stored) {
             Node *p = 0; 
-            Node *n = &nodes[index];
-            while (n && n->key != key) {
+            Node *n = head;
+            while (n && (n->hash_value != h || n->key != key)) {
                 p = n;
                 n = n->next;
             }
@@ -109,24 +160,27 @@ public:
             //if we found n
             if (n) {
                 //if it is in the original node
-                if (n == &nodes[index]) {
+                if (n == head) {
                     if (n->next == 0) {
                         //if this is only node, just clear the stored flag
-                        nodes[index].stored = false;
+                        head->stored = false;
                     } else {
                         //otherwise, copy next node into original node 
                         Node *t = n->next;
                         n->key = n->next->key;
                         n->value = n->next->value;
                         n->weight = n->next->weight; 
+                        n->hash_value = n->next->hash_value;
                         n->next = n->next->next;
-                        delete t; 
+                        pool.deallocate(t); 
                     }
                 } else {
                     //otherwise, remove from linked list
                     p->next = n->next;
-                    delete n;
+                    pool.deallocate(n);
                 } 
+
+                --count;
             }
         } 
     }
@@ -137,139 +191,666 @@ private:
         K key;
         V value; 
         size_t weight;
+        unsigned int hash_value;
         bool stored;
         Node *next;
 
         Node() : stored(false), next(0) {};
     };
+
+    //number of old buckets moved to the new table on each operation while resizing
+    static const size_t MIGRATE_BUCKETS = 2;
+
+    //number of keys in flight at once in find_batch
+    static const size_t PREFETCH_BATCH = 16;
  
     Node *nodes;
     size_t count;
     size_t size; 
-    HashFunction hash;
+    Hash hash;
+    Allocator<Node> pool;
+    float max_load;
     bool self_adjust;
+
+    //table being drained while resizing, buckets below migrated have been moved
+    Node *old_nodes;
+    size_t old_size;
+    size_t migrated;
+
+    void free_table(Node *table, size_t table_size)
+    {
+        if (Allocator<Node>::NEEDS_RELEASE) {
+            for (size_t i = 0; i < table_size; ++i) {
+                Node *n = table[i].next;
+                while(n) {
+                    Node *t = n;
+                    n = n->next;
+                    pool.release(t);
+                }
+            }
+        }
+
+        delete[] table; 
+    }
+
+    //bucket currently holding keys with hash h
+    Node *bucket(unsigned int h)
+    {
+        if (old_nodes) {
+            size_t index = h % old_size;
+            if (index >= migrated) return &old_nodes[index];
+        }
+
+        return &nodes[h % size];
+    }
+
+    //start moving entries into a table twice the size 
+    void grow()
+    {
+        //finish any resize still in progress
+        while (old_nodes) migrate_step();
+
+        old_nodes = nodes;
+        old_size = size;
+        migrated = 0;
+
+        size *= 2;
+        nodes = new Node[size];
+    }
+
+    void migrate_step()
+    {
+        if (!old_nodes) return;
+
+        for (size_t i = 0; i < MIGRATE_BUCKETS && migrated < old_size; ++i) {
+            migrate_bucket(migrated);
+            ++migrated;
+        }
+
+        if (migrated == old_size) {
+            delete[] old_nodes;
+            old_nodes = 0;
+            old_size = 0;
+            migrated = 0;
+        }
+    }
+
+    //move an old bucket into the new table, appending so each chain keeps its order
+    void migrate_bucket(size_t index)
+    {
+        Node *old = &old_nodes[index];
+        if (!old->stored) return;
+
+        //the inline head has to be copied, overflow nodes are relinked
+        Node *head = &nodes[old->hash_value % size];
+        if (!head->stored) {
+            head->key = old->key;
+            head->value = old->value;
+            head->weight = old->weight;
+            head->hash_value = old->hash_value;
+            head->stored = true;
+        } else {
+            Node *t = head;
+            while (t->next) t = t->next;
+            t->next = pool.allocate();
+            t->next->key = old->key;
+            t->next->value = old->value;
+            t->next->weight = old->weight;
+            t->next->hash_value = old->hash_value;
+        }
+
+        Node *n = old->next;
+        old->stored = false;
+        old->next = 0;
+
+        while (n) {
+            Node *next = n->next;
+
+            head = &nodes[n->hash_value % size];
+            if (!head->stored) {
+                head->key = n->key;
+                head->value = n->value;
+                head->weight = n->weight;
+                head->hash_value = n->hash_value;
+                head->stored = true;
+                pool.deallocate(n);
+            } else {
+                Node *t = head;
+                while (t->next) t = t->next;
+                t->next = n;
+                n->next = 0;
+            }
+
+            n = next;
+        }
+    }
 };
 
-template<class K, class V> class SelfAdjustingBiasedHashtable {
+/*
+Open addressing version using linear probing with a Robin Hood style
+displacement rule.  Heavier keys take the slot from lighter ones, so they
+stay at or close to their home slot, and equal weights fall back to the
+usual rule of evicting the entry closest to its home.  Each home slot
+records how far its furthest key was pushed, and lookups scan only that
+far.  Removals shift the rest of the run back a slot and recompute the
+reach of the homes whose keys moved, so probes get shorter again after
+keys are removed.  max_load must be below 1, as a full table has no empty
+slot to end a probe.
+*/
+template<class K, class V, class Hash = KeyHash> class RobinHoodBiasedHashtable {
 
 public:
 
-    typedef unsigned int (*HashFunction)(const K &key);
+    RobinHoodBiasedHashtable(size_t initial_size, Hash hash = Hash(), float max_load = 0.8f) : count(0), size(initial_size), hash(hash), max_load(max_load)
+    {
+        if (!(max_load > 0.0f && max_load < 1.0f)) throw std::invalid_argument("RobinHoodBiasedHashtable: max_load must be in (0, 1)");
+
+        if (size == 0) size = 1;
+        slots = new Slot[size];
+    }
 
-    SelfAdjustingBiasedHashtable(size_t initial_size, HashFunction hash) : count(0), size(initial_size), hash(hash)
+    virtual ~RobinHoodBiasedHashtable()
     {
-        nodes = new Node[size]; 
+        delete[] slots;
+    }
+
+    void insert(const K &key, const V &value, size_t weight)
+    {
+        if ((float)(count + 1) > max_load * (float)size) grow();
+
+        K k = key;
+        V v = value;
+        place(k, v, weight, hash(key) % size);
+
+        ++count;
+    }
+
+    template<class Q> V *find(const Q &key)
+    {
+        size_t index = hash(key) % size;
+        size_t reach = slots[index].reach;
+
+        //a key at distance d from home can only be in a slot storing distance d
+        for (size_t d = 0; d <= reach; ++d) {
+            Slot &s = slots[index];
+            if (s.stored && s.dist == d && s.key == key) return &s.value;
+            index = next(index);
+        }
+
+        return 0;
+    }
+
+    template<class Q> void remove(const Q &key)
+    {
+        size_t index = hash(key) % size;
+        size_t reach = slots[index].reach;
+
+        for (size_t d = 0; d <= reach; ++d) {
+            Slot &s = slots[index];
+            if (s.stored && s.dist == d && s.key == key) {
+                erase(index);
+                --count;
+                break;
+            }
+
+            index = next(index);
+        }
+    }
+
+private:
+
+    struct Slot {
+        K key;
+        V value;
+        size_t weight;
+        size_t dist;
+        size_t reach;
+        bool stored;
+
+        Slot() : weight(0), dist(0), reach(0), stored(false) {};
+    };
+
+    Slot *slots;
+    size_t count;
+    size_t size;
+    Hash hash;
+    float max_load;
+
+    size_t next(size_t index)
+    {
+        return index + 1 == size ? 0 : index + 1;
+    }
+
+    //probe from index, swapping the entry being placed with any lighter resident
+    void place(K &key, V &value, size_t weight, size_t index)
+    {
+        size_t dist = 0;
+        while (true) {
+            Slot &s = slots[index];
+
+            if (!s.stored) {
+                std::swap(s.key, key);
+                std::swap(s.value, value);
+                s.weight = weight;
+                s.dist = dist;
+                s.stored = true;
+                note_reach(index, dist);
+                return;
+            }
+
+            if (s.weight < weight || (s.weight == weight && s.dist < dist)) {
+                std::swap(s.key, key);
+                std::swap(s.value, value);
+                std::swap(s.weight, weight);
+                std::swap(s.dist, dist);
+                note_reach(index, s.dist);
+            }
+
+            index = next(index);
+            ++dist;
+        }
+    }
+
+    void note_reach(size_t index, size_t dist)
+    {
+        size_t home = (index + size - dist) % size;
+        if (slots[home].reach < dist) slots[home].reach = dist;
+    }
+
+    //lower the reach of home to the distance of its furthest key
+    void update_reach(size_t home)
+    {
+        size_t d = slots[home].reach;
+        while (d > 0) {
+            Slot &s = slots[(home + d) % size];
+            if (s.stored && s.dist == d) break;
+            --d;
+        }
+
+        slots[home].reach = d;
+    }
+
+    //empty the slot at index and shift the following entries which are
+    //away from home back by one, until an empty slot or one at home.  The
+    //entries keep their order, so heavier keys still come first.
+    void erase(size_t index)
+    {
+        size_t home = (index + size - slots[index].dist) % size;
+        size_t first = index;
+
+        size_t n = next(index);
+        while (slots[n].stored && slots[n].dist > 0) {
+            Slot &s = slots[index];
+            std::swap(s.key, slots[n].key);
+            std::swap(s.value, slots[n].value);
+            s.weight = slots[n].weight;
+            s.dist = slots[n].dist - 1;
+
+            index = n;
+            n = next(n);
+        }
+
+        slots[index].key = K();
+        slots[index].value = V();
+        slots[index].stored = false;
+
+        update_reach(home);
+        for (size_t i = first; i != index; i = next(i)) {
+            update_reach((i + size - slots[i].dist) % size);
+        }
+    }
+
+    void grow()
+    {
+        Slot *old_slots = slots;
+        size_t old_size = size;
+
+        size *= 2;
+        slots = new Slot[size];
+
+        for (size_t i = 0; i < old_size; ++i) {
+            if (old_slots[i].stored) {
+                place(old_slots[i].key, old_slots[i].value, old_slots[i].weight, hash(old_slots[i].key) % size);
+            }
+        }
+
+        delete[] old_slots;
+    }
+};
+
+/*
+Open addressing version which probes groups of slots at a time, along the
+lines of the Swiss tables used in Abseil.  A control byte per slot holds
+a 7 bit fingerprint of the hash, and a whole group of control bytes is
+compared with one SSE2 instruction, or a loop where SSE2 is missing, so a
+key is only compared when its fingerprint matches.  The entries of a group
+fill its first slots in order of decreasing weight, so matches for heavier
+keys are tested first, and the lightest entries of a full group overflow
+into the next one.  Removal shifts the lighter entries of the group down
+to close the gap.
+*/
+template<class K, class V, class Hash = KeyHash> class GroupedBiasedHashtable {
+
+public:
+
+    GroupedBiasedHashtable(size_t initial_size, Hash hash = Hash(), float max_load = 0.875f) : count(0), deleted(0), hash(hash), max_load(max_load)
+    {
+        groups = (initial_size + GROUP_SIZE - 1) / GROUP_SIZE;
+        if (groups == 0) groups = 1;
+        allocate();
+    }
+
+    virtual ~GroupedBiasedHashtable()
+    {
+        delete[] ctrl;
+        delete[] slots;
+    }
+
+    void insert(const K &key, const V &value, size_t weight)
+    {
+        //tombstones count towards the load since they lengthen probes
+        if ((float)(count + deleted + 1) > max_load * (float)(groups * GROUP_SIZE)) grow();
+
+        K k = key;
+        V v = value;
+        place(k, v, weight, hash(key));
+
+        ++count;
+    }
+
+    template<class Q> V *find(const Q &key)
+    {
+        size_t index = locate(key);
+        return index < groups * GROUP_SIZE ? &slots[index].value : 0;
+    }
+
+    template<class Q> void remove(const Q &key)
+    {
+        size_t index = locate(key);
+        if (index < groups * GROUP_SIZE) {
+
+            //shift the lighter entries after it down, which frees the last
+            //used slot of the group
+            size_t end = index - index % GROUP_SIZE + GROUP_SIZE;
+            while (index + 1 < end && ctrl[index + 1] != EMPTY && ctrl[index + 1] != DELETED) {
+                std::swap(slots[index].key, slots[index + 1].key);
+                std::swap(slots[index].value, slots[index + 1].value);
+                slots[index].weight = slots[index + 1].weight;
+                ctrl[index] = ctrl[index + 1];
+                ++index;
+            }
+
+            slots[index].key = K();
+            slots[index].value = V();
+
+            //a group with an empty slot has never been full, so no probe
+            //continues past it and the slot can be marked empty again
+            if (match(&ctrl[end - GROUP_SIZE], EMPTY)) {
+                ctrl[index] = EMPTY;
+            } else {
+                ctrl[index] = DELETED;
+                ++deleted;
+            }
+
+            --count;
+        }
+    }
+
+private:
+
+    static const size_t GROUP_SIZE = 16;
+
+    //control bytes, fingerprints use the low 7 bits
+    static const unsigned char EMPTY = 0x80;
+    static const unsigned char DELETED = 0xFE;
+
+    struct Slot {
+        K key;
+        V value;
+        size_t weight;
+    };
+
+    unsigned char *ctrl;
+    Slot *slots;
+    size_t groups;
+    size_t count;
+    size_t deleted;
+    Hash hash;
+    float max_load;
+
+    void allocate()
+    {
+        ctrl = new unsigned char[groups * GROUP_SIZE];
+        for (size_t i = 0; i < groups * GROUP_SIZE; ++i) ctrl[i] = EMPTY;
+        slots = new Slot[groups * GROUP_SIZE];
+    }
+
+    //bit i set if control byte i of the group equals c
+    static unsigned int match(const unsigned char *group, unsigned char c)
+    {
+#if defined(__SSE2__)
+        __m128i g = _mm_loadu_si128((const __m128i *)group);
+        return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8((char)c)));
+#else
+        unsigned int mask = 0;
+        for (size_t i = 0; i < GROUP_SIZE; ++i) {
+            if (group[i] == c) mask |= 1u << i;
+        }
+        return mask;
+#endif
+    }
+
+    //slot index holding key, or groups * GROUP_SIZE if not present
+    template<class Q> size_t locate(const Q &key)
+    {
+        unsigned int h = hash(key);
+        unsigned char fingerprint = h & 0x7F;
+        size_t g = (h >> 7) % groups;
+
+        for (size_t probes = 0; probes < groups; ++probes) {
+            const unsigned char *group = &ctrl[g * GROUP_SIZE];
+
+            //matches come out lowest slot first, which is heaviest first
+            unsigned int m = match(group, fingerprint);
+            while (m) {
+                size_t index = g * GROUP_SIZE + __builtin_ctz(m);
+                if (slots[index].key == key) return index;
+                m &= m - 1;
+            }
+
+            if (match(group, EMPTY)) break;
+            g = g + 1 == groups ? 0 : g + 1;
+        }
+
+        return groups * GROUP_SIZE;
+    }
+
+    //insertion sort by weight into the home group, carrying the lightest
+    //entry of a full group on to the next group.  The used slots of a group
+    //come first, so the first free slot is the end of the sorted run.
+    void place(K &key, V &value, size_t weight, unsigned int h)
+    {
+        unsigned char fingerprint = h & 0x7F;
+        size_t g = (h >> 7) % groups;
+
+        while (true) {
+            for (size_t i = g * GROUP_SIZE; i < (g + 1) * GROUP_SIZE; ++i) {
+                if (ctrl[i] == EMPTY || ctrl[i] == DELETED) {
+                    if (ctrl[i] == DELETED) --deleted;
+                    std::swap(slots[i].key, key);
+                    std::swap(slots[i].value, value);
+                    slots[i].weight = weight;
+                    ctrl[i] = fingerprint;
+                    return;
+                }
+
+                if (slots[i].weight < weight) {
+                    std::swap(slots[i].key, key);
+                    std::swap(slots[i].value, value);
+                    std::swap(slots[i].weight, weight);
+                    std::swap(ctrl[i], fingerprint);
+                }
+            }
+
+            g = g + 1 == groups ? 0 : g + 1;
+        }
+    }
+
+    void grow()
+    {
+        unsigned char *old_ctrl = ctrl;
+        Slot *old_slots = slots;
+        size_t old_size = groups * GROUP_SIZE;
+
+        //only double if the load is not mostly tombstones
+        if (count * 2 >= deleted) groups *= 2;
+        deleted = 0;
+        allocate();
+
+        for (size_t i = 0; i < old_size; ++i) {
+            if (old_ctrl[i] != EMPTY && old_ctrl[i] != DELETED) {
+                place(old_slots[i].key, old_slots[i].value, old_slots[i].weight, hash(old_slots[i].key));
+            }
+        }
+
+        delete[] old_ctrl;
+        delete[] old_slots;
+    }
+};
+
+/*
+Self-adjusting version, each hit is moved to the front of its chain.  Buckets
+hold only a pointer to the first node so a move to front just relinks nodes
+and never copies keys or values.
+*/
+template<class K, class V, class Hash = KeyHash, template<class> class Allocator = SlabAllocator> class SelfAdjustingBiasedHashtable {
+
+public:
+
+    SelfAdjustingBiasedHashtable(size_t initial_size, Hash hash = Hash()) : count(0), size(initial_size), hash(hash)
+    {
+        if (size == 0) size = 1;
+        buckets = new Node *[size];
+        for (size_t i = 0; i < size; ++i) buckets[i] = 0;
     } 
 
     virtual ~SelfAdjustingBiasedHashtable()
     {
-        for (size_t i = 0; i < size; ++i) {
-            Node *n = nodes[i].next;
-            while(n) {
-                Node *t = n;
-                n = n->next;
-                delete t;
+        if (Allocator<Node>::NEEDS_RELEASE) {
+            for (size_t i = 0; i < size; ++i) {
+                Node *n = buckets[i];
+                while(n) {
+                    Node *t = n;
+                    n = n->next;
+                    pool.release(t);
+                }
             }
         }
 
-        delete[] nodes; 
+        delete[] buckets; 
     }
 
     void insert(const K &key, const V &value)
     {
-        size_t index = hash(key) % size;
-        if (!nodes[index].stored) {
-            //just insert node if no collision
-            nodes[index].key = key;
-            nodes[index].value = value;
-            nodes[index].stored = true;
-        } else { 
-            //copy old node and add to linked list
-            Node *t = nodes[index].next;
-            nodes[index].next = new Node;
-            nodes[index].next->key = nodes[index].key;
-            nodes[index].next->value = nodes[index].value;
-            nodes[index].next->next = t;
-
-            //insert new node at front
-            nodes[index].key = key;
-            nodes[index].value = value;
-        } 
+        //insert new node at front
+        unsigned int h = hash(key);
+        size_t index = h % size;
+        Node *n = pool.allocate();
+        n->key = key;
+        n->value = value;
+        n->hash_value = h;
+        n->next = buckets[index];
+        buckets[index] = n;
 
         ++count;
     } 
 
-    V *find(const K &key)
+    template<class Q> V *find(const Q &key)
     {
-        V *result = 0;
-        size_t index = hash(key) % size;
-        if (nodes[index].stored) {
-            Node *p = 0; 
-            Node *n = &nodes[index];
-            while (n && n->key != key) {
-                p = n;
-                n = n->next;
+        unsigned int h = hash(key);
+        size_t index = h % size;
+
+        //p points at the link to n, cached hashes are compared before keys
+        Node **p = &buckets[index];
+        Node *n = *p;
+        while (n && (n->hash_value != h || n->key != key)) {
+            p = &n->next;
+            n = n->next;
+        }
+
+        if (!n) return 0;
+
+        //if not already at head of list, move to front
+        if (n != buckets[index]) {
+            *p = n->next;
+            n->next = buckets[index];
+            buckets[index] = n;
+        }
+
+        return &n->value;
+    }
+
+    //look up n keys at once, storing a pointer to each value or 0 in results.
+    //all bucket heads and first chain nodes are prefetched before any key
+    //is compared so the cache misses overlap
+    template<class Q> void find_batch(const Q *keys, size_t n, V **results)
+    {
+        unsigned int hashes[PREFETCH_BATCH];
+
+        for (size_t begin = 0; begin < n; begin += PREFETCH_BATCH) {
+            size_t end = begin + PREFETCH_BATCH < n ? begin + PREFETCH_BATCH : n;
+
+            for (size_t i = begin; i < end; ++i) {
+                hashes[i - begin] = hash(keys[i]);
+                __builtin_prefetch(&buckets[hashes[i - begin] % size]);
             }
 
-            if (n) {
-                result = &n->value;
+            for (size_t i = begin; i < end; ++i) {
+                Node *head = buckets[hashes[i - begin] % size];
+                if (head) __builtin_prefetch(head);
+            }
 
-                //if not already at head of list, move to front
-                if (n != &nodes[index]) {
+            //earlier keys in the batch may have changed a chain, so each
+            //find starts again from its bucket
+            for (size_t i = begin; i < end; ++i) {
+                unsigned int h = hashes[i - begin];
+                Node **head = &buckets[h % size];
+                Node **p = head;
+                Node *n = *p;
+                while (n && (n->hash_value != h || n->key != keys[i])) {
+                    p = &n->next;
+                    n = n->next;
+                }
 
-                    //move n to just after head of list
-                    p->next = n->next;
-                    Node *t = nodes[index].next;
-                    nodes[index].next = n;
-                    n->next = t;
-                    
-                    //copy from old head to n
-                    n->key = nodes[index].key;
-                    n->value = nodes[index].value;
-
-                    //set up new head 
-                    nodes[index].key = key;
-                    nodes[index].value = *result;
+                if (n && p != head) {
+                    *p = n->next;
+                    n->next = *head;
+                    *head = n;
                 }
+
+                results[i] = n ? &n->value : 0;
             }
         }
-
-        return result;
     }
 
-    void remove(const K &key)
+    template<class Q> void remove(const Q &key)
     { 
-        size_t index = hash(key) % size;
-        if (nodes[index].stored) {
-            Node *p = 0; 
-            Node *n = &nodes[index];
-            while (n && n->key != key) {
-                p = n;
-                n = n->next;
-            }
+        unsigned int h = hash(key);
+        size_t index = h % size;
+
+        Node **p = &buckets[index];
+        Node *n = *p;
+        while (n && (n->hash_value != h || n->key != key)) {
+            p = &n->next;
+            n = n->next;
+        }
 
-            //if we found n
-            if (n) {
-                //if it is in the original node
-                if (n == &nodes[index]) {
-                    if (n->next == 0) {
-                        //if this is only node, just clear the stored flag
-                        nodes[index].stored = false;
-                    } else {
-                        //otherwise, copy next node into original node 
-                        Node *t = n->next;
-                        n->key = n->next->key;
-                        n->value = n->next->value;
-                        n->next = n->next->next;
-                        delete t; 
-                    }
-                } else {
-                    //otherwise, remove from linked list
-                    p->next = n->next;
-                    delete n;
-                } 
-            }
-        } 
+        //if we found n, remove from linked list
+        if (n) {
+            *p = n->next;
+            pool.deallocate(n);
+            --count;
+        }
     }
 
 private:
@@ -277,16 +858,20 @@ private:
     struct Node {
         K key;
         V value; 
-        bool stored;
+        unsigned int hash_value;
         Node *next;
 
-        Node() : stored(false), next(0) {};
+        Node() : next(0) {};
     };
+
+    //number of keys in flight at once in find_batch
+    static const size_t PREFETCH_BATCH = 16;
  
-    Node *nodes;
+    Node **buckets;
     size_t count;
     size_t size; 
-    HashFunction hash;
+    Hash hash;
+    Allocator<Node> pool;
 };
 
 
@@ -27,6 +27,11 @@ THE SOFTWARE.
 #include <cmath>
 #include <fstream>
 #include <limits>
+#include <utility>
+#include <vector>
+
+#include "random.h"
+#include "slab_allocator.h"
 
 /* 
 Skip list implementation for weighted / biased searches.
@@ -34,23 +39,48 @@ Skip list implementation for weighted / biased searches.
 Based upon the description in: 
 Bagchi, A., Buchsbaum, A., Goodrich, M. T., (2005) Biased Skip Lists.
 Algorithmica, Vol 42, Number 1, pp. 31--48.  
+
+A Finger keeps the predecessors of the last key searched through it, so a
+stream of nearby keys can be found or inserted by climbing only as high as
+the distance between them, as described in:
+Pugh, W., (1990) A Skip List Cookbook.  Technical Report CS-TR-2286.1,
+University of Maryland.
+
+In self-adjusting mode tower heights follow observed accesses rather than
+the weights given, see adapt() and cool().
+
+Random is the random number policy, see random.h.
 */
 
-template<class K, class V> class BiasedSkiplist {
+template<class K, class V, class Random = XorShiftRandom> class BiasedSkiplist {
 
 public:
 
-	BiasedSkiplist(size_t max_level) : level(1), max_level(max_level)
+	class Finger;
+
+	//STATIC keeps the towers drawn from the weights.  SELF_ADJUST raises
+	//and lowers them with decayed, approximate access counts.
+	enum Mode {
+		STATIC,
+		SELF_ADJUST
+	};
+
+	BiasedSkiplist(size_t max_level, uint64_t seed = DEFAULT_RANDOM_SEED) : level(1), max_level(max_level), mode(STATIC), count(0), epoch(0), accesses(0), version(1), random(seed)
 	{
-		head = new Node(max_level, max_level, 0);
+		head = new_node(max_level);
+	}
+
+	BiasedSkiplist(size_t max_level, Mode mode, uint64_t seed = DEFAULT_RANDOM_SEED) : level(1), max_level(max_level), mode(mode), count(0), epoch(0), accesses(0), version(1), random(seed)
+	{
+		head = new_node(max_level);
 	}
 
 	virtual ~BiasedSkiplist()
 	{
 		Node *n = head;
 		while (n != 0) {
-			Node *t = n->next[0];
-			delete n;
+			Node *t = n->next(0);
+			delete_node(n);
 			n = t;
 		}
 	}
@@ -58,143 +88,429 @@ public:
 	void insert(const K &key, const V &value, size_t weight)
 	{
         //pick level based upon weight 
-		size_t insert_level = random_level(weight);
-		if (insert_level > max_level) insert_level = max_level;
+		size_t base = weight_level(weight);
+		size_t insert_level = tower_level(base);
         if (insert_level > level) level = insert_level;
 
 		//allocate space on stack for nodes which need to be updated
 		Node **update = (Node **)alloca(insert_level * sizeof(Node *));
 
-		//search through skip list to find predecessor at each level
+		//search through skip list from the top, keeping the predecessor at
+		//each level the new node will be linked into
         Node *t = head;
-		for (size_t i = insert_level - 1; i >= 0 && i < insert_level; --i) {
-			while (t->next[i] != 0 && t->next[i]->key < key) t = t->next[i];
-			update[i] = t;
+		for (size_t i = level - 1; i >= 0 && i < level; --i) {
+			while (t->next(i) != 0 && t->next(i)->key < key) t = t->next(i);
+			if (i < insert_level) update[i] = t;
 		}
 
         //we don't handle duplicate keys
-        if (t->next[0] && t->next[0]->key == key) { 
+        if (t->next(0) && t->next(0)->key == key) { 
             return;
         }
 
         //create new node 
-		Node *n = new Node(insert_level, insert_level, weight); 
+		Node *n = new_node(insert_level); 
        
 		n->key = key;
 		n->value = value; 
+		set_base(n, base);
+		++count;
 
 		//splice into skip list
 		for (size_t i = 0; i < insert_level; ++i) {
-			n->next[i] = update[i]->next[i];
-			update[i]->next[i] = n;
+			n->next(i) = update[i]->next(i);
+			update[i]->next(i) = n;
 		} 
 	}
 
-	V *find(const K &key)
+	//as insert, but searching from finger, which is left at key
+	void insert(Finger &finger, const K &key, const V &value, size_t weight)
 	{
-        V *result = 0;
+		size_t base = weight_level(weight);
+		size_t insert_level = tower_level(base);
+		if (insert_level > level) level = insert_level;
+
+		//we don't handle duplicate keys
+		if (seek(finger, key, insert_level)) {
+			return;
+		}
+
+		Node *n = new_node(insert_level); 
+
+		n->key = key;
+		n->value = value; 
+		set_base(n, base);
+		++count;
+
+		//the finger holds the predecessors of key up to insert_level
+		for (size_t i = 0; i < insert_level; ++i) {
+			n->next(i) = finger.pred[i]->next(i);
+			finger.pred[i]->next(i) = n;
+		} 
+	}
+
+	//Q can be any type ordered against and equality comparable with K.
+	//In self-adjusting mode a hit may move key to a node with a taller
+	//tower, and an epoch change to a shorter one, which leaves pointers
+	//returned by earlier finds dangling.  Use a pointer only until the
+	//next find, reweight or remove.
+	template<class Q> V *find(const Q &key)
+	{
+		if (mode == SELF_ADJUST && accesses >= count) cool();
+
+        Node *n = 0;
 
         Node *t = head;
 		for (size_t i = level - 1; i >= 0 && i < level; --i) {
-			while (t->next[i] != 0 && t->next[i]->key < key) t = t->next[i];
-			if (t->next[i] && t->next[i]->key == key) {
-				result = &t->next[i]->value;
+			while (t->next(i) != 0 && t->next(i)->key < key) t = t->next(i);
+			if (t->next(i) && t->next(i)->key == key) {
+				n = t->next(i);
 				break;
 			}
 		}
 
-		return result;
+		if (!n) return 0;
+
+		//if adapting weights, count the hit, which may move the node
+		if (mode == SELF_ADJUST) n = adapt(n);
+
+		return &n->value;
 	}
 
-	void remove(const K &key)
+	//as find, but searching from finger, which is left at key.  The same
+	//caveat on returned pointers applies.
+	template<class Q> V *find(Finger &finger, const Q &key)
+	{
+		if (mode == SELF_ADJUST && accesses >= count) cool();
+
+		Node *n = seek(finger, key, 0);
+		if (!n) return 0;
+
+		if (mode == SELF_ADJUST) n = adapt(n);
+
+		return &n->value;
+	}
+
+	template<class Q> void remove(const Q &key)
 	{
 		//search through skip list to find predecessor at each level
         //and update links to splice out removed key
         Node *t = head;
 		for (size_t i = level - 1; i >= 0 && i < level; --i) {
-			while (t->next[i] != 0 && t->next[i]->key < key) t = t->next[i]; 
-            if (t->next[i]) { 
+			while (t->next(i) != 0 && t->next(i)->key < key) t = t->next(i); 
+            if (t->next(i) && t->next(i)->key == key) { 
+                Node *n = t->next(i);
+                t->next(i) = n->next(i); 
+
+                //if at lowest level, also free memory
                 if (i == 0) {
-                    //if at lowest level, also free memory
-                    Node *temp = t->next[i];
-                    t->next[i] = t->next[i]->next[i]; 
-                    delete temp;
-                } else {
-                    t->next[i] = t->next[i]->next[i]; 
+                    delete_node(n);
+                    --count;
+                    ++version;
                 }
             }
 		} 
 	}
 
-	void reweight(const K &key, size_t weight) 
+	//draw a new level for key from weight.  In self-adjusting mode this
+	//also resets its access count to weight.
+	template<class Q> void reweight(const Q &key, size_t weight) 
 	{
-        Node *t = head;
-		for (size_t i = level - 1; i >= 0 && i < level; --i) {
-			while (t->next[i] != 0 && t->next[i]->key < key) t = t->next[i];
-			if (t->next[i] && t->next[i]->key == key) { 
-                Node *n = t->next[i];
-
-                size_t new_level = random_level(weight);
-                if (new_level > n->level) {
-
-                    //search through skip list to find predecessor at each level and update
-                    Node *p = head;
-                    for (size_t j = new_level - 1; j > i && j < new_level; --j) {
-                        while (p->next[j] != 0 && p->next[j]->key < n->key) p = p->next[j];
-                        n->next[j] = p->next[j];
-                        p->next[j] = n; 
-                    } 
-
-                } else if (new_level < t->next[i]->level) { 
-                    //remove from levels
-                    for (size_t j = n->level; j >= new_level && j < n->level; --j) {
-                        t->next[i] = t->next[i]->next[i]; 
-                    } 
-                }
+		size_t base = weight_level(weight);
+		Node *n = relevel(key, tower_level(base));
+		if (n) set_base(n, base);
+	}
 
-                n->level = new_level;
-            } 
-            break;
+	//height of the tower of key, 0 if it is not present.  Does not count
+	//as an access.
+	template<class Q> size_t height(const Q &key)
+	{
+		Node *t = head;
+		for (size_t i = level - 1; i >= 0 && i < level; --i) {
+			while (t->next(i) != 0 && t->next(i)->key < key) t = t->next(i);
+			if (t->next(i) && t->next(i)->key == key) return t->next(i)->level;
 		}
+
+		return 0;
 	}
 
 private:
 
-	struct Node {
+	//the tower of level next pointers is stored inline, straight after the
+	//node, so each node is one block sized to its own level.  The node is
+	//aligned for the pointers that follow it.
+	struct alignas(void *) Node {
 		K key;
 		V value;
-		size_t level;
-		Node **next;
+		unsigned int level;
 
-		Node(size_t level, size_t max_level, size_t weight) : level(level)
+		Node(size_t level) : key(), value(), level((unsigned int)level)
 		{
-			next = new Node *[max_level];
-
-			for (size_t i = 0; i < max_level; ++i)
-			{
-				next[i] = 0;
-			}
+			for (size_t i = 0; i < level; ++i) next(i) = 0;
 		}
 
-		virtual ~Node()
+		Node *&next(size_t i)
 		{
-			delete[] next;
+			return ((Node **)(this + 1))[i];
 		}
 	};
 
+	//self-adjusting lists keep these after the tower, so static nodes do
+	//without them.  base is the height the tower was built for before any
+	//extra random levels, and rank the access level, see adapt().
+	struct Counts {
+		unsigned int base;
+		unsigned int rank;
+	};
+
 	Node *head;
 	size_t level;
 	size_t max_level;
 
-	size_t random_level(size_t weight)
+	//self-adjusting state, the epoch advances once per count accesses
+	Mode mode;
+	size_t count;
+	unsigned int epoch;
+	size_t accesses;
+
+	//changed whenever nodes are freed or their towers rebuilt, so fingers
+	//can tell when their predecessors may have gone
+	uint64_t version;
+
+	Random random;
+	ChunkAllocator arena;
+
+	//give key a tower of new_level.  The node is unlinked and, if its tower
+	//changes height, moved to a node of the new size, which is returned.
+	template<class Q> Node *relevel(const Q &key, size_t new_level)
 	{
-		if (weight == 0) weight = 1;
+		size_t top = new_level > level ? new_level : level;
 
-        size_t level = 1 + (int)(log((float)weight)/log(2.0f));
+		Node **update = (Node **)alloca(top * sizeof(Node *));
+
+        Node *t = head;
+		for (size_t i = top - 1; i >= 0 && i < top; --i) {
+			while (t->next(i) != 0 && t->next(i)->key < key) t = t->next(i);
+			update[i] = t;
+		}
+
+		Node *n = t->next(0);
+		if (!n || !(n->key == key)) return 0;
+
+		++version;
+
+		for (size_t i = 0; i < n->level; ++i) {
+			update[i]->next(i) = n->next(i);
+		}
+
+		if (new_level != n->level) n = move_node(n, new_level);
+
+		for (size_t i = 0; i < new_level; ++i) {
+			n->next(i) = update[i]->next(i);
+			update[i]->next(i) = n;
+		}
+
+		level = top;
+		return n;
+	}
+
+	size_t node_size(size_t level)
+	{
+		size_t size = sizeof(Node) + level*sizeof(Node *);
+		if (mode == SELF_ADJUST) size += sizeof(Counts);
+		return size;
+	}
 
-		while ((float)rand() / (float)RAND_MAX < 0.5) ++level;
+	Node *new_node(size_t level)
+	{
+		Node *n = new (arena.allocate(node_size(level))) Node(level);
+		if (mode == SELF_ADJUST) {
+			counts(n).base = 1;
+			counts(n).rank = 0;
+		}
+		return n;
+	}
+
+	Counts &counts(Node *n)
+	{
+		return *(Counts *)(&n->next(0) + n->level);
+	}
+
+	//replace n, which must be unlinked, by a node with a tower of
+	//new_level, moving its key, value and counts across
+	Node *move_node(Node *n, size_t new_level)
+	{
+		Node *m = new_node(new_level);
+		m->key = std::move(n->key);
+		m->value = std::move(n->value);
+		if (mode == SELF_ADJUST) counts(m) = counts(n);
+		delete_node(n);
+		return m;
+	}
+
+	void delete_node(Node *n)
+	{
+		size_t size = node_size(n->level);
+		n->~Node();
+		arena.deallocate(n, size);
+	}
+
+	//true if p is still the predecessor of key at level i, i.e. key falls
+	//between p and its successor there
+	template<class Q> bool brackets(Node *p, size_t i, const Q &key)
+	{
+		if (p != head && !(p->key < key)) return false;
+		return !p->next(i) || !(p->next(i)->key < key);
+	}
+
+	//search for key from finger, returning its node if present.  The search
+	//climbs to the lowest level at which the finger brackets key, and which
+	//has the finger bracketing key at every level above it below top, then
+	//descends leaving the finger at the predecessors of key, down to the
+	//level key is found at.  Nodes between the last key and this one cut
+	//the finger only up to their own height, so both take time logarithmic
+	//in the distance between the keys.
+	template<class Q> Node *seek(Finger &finger, const Q &key, size_t top)
+	{
+		//after a remove start again from the head, which precedes every
+		//key at every level
+		if (finger.version != version) {
+			for (size_t i = 0; i < max_level; ++i) finger.pred[i] = head;
+			finger.version = version;
+		}
+
+		//i is one above the highest level checked so far that is stale
+		size_t i = 0;
+		for (size_t j = 0; j < level && (j < top || i == j); ++j) {
+			if (!brackets(finger.pred[j], j, key)) i = j + 1;
+		}
+
+		Node *t = i < level ? finger.pred[i] : head;
+		size_t j = i < level ? i + 1 : level;
+		while (j-- > 0) {
+			while (t->next(j) != 0 && t->next(j)->key < key) t = t->next(j);
+			finger.pred[j] = t;
+			if (t->next(j) && t->next(j)->key == key) return t->next(j);
+		}
+
+		return 0;
+	}
+
+	//base levels plus a geometric number of extra levels, taken as the run
+	//of set low bits in one random word, at most max_level.  For a weight
+	//the base is 1 + log2(weight).
+	size_t tower_level(size_t base)
+	{
+		size_t level = base + random_heads(random.next());
+		if (level > max_level) level = max_level;
 		return level;
 	}
+
+	//the access level of a node starts at the log of its weight
+	void set_base(Node *n, size_t base)
+	{
+		if (mode != SELF_ADJUST) return;
+		counts(n).base = (unsigned int)base;
+		counts(n).rank = epoch + (unsigned int)base - 1;
+	}
+
+	//access level of n, decayed to the current epoch
+	size_t access_level(Node *n)
+	{
+		unsigned int rank = counts(n).rank;
+		return rank > epoch ? rank - epoch : 0;
+	}
+
+	/*
+	In self-adjusting mode each node keeps the log of an approximate access
+	count as a Morris counter, as BiasedTreap does in adaptive mode: a hit
+	bumps the access level with probability 2^-level, so most hits write
+	nothing.  The level is kept as the epoch of the last bump plus the
+	level, and measured against the current epoch it drops by one each
+	epoch, halving the count of keys which are no longer hit.  When a bump
+	takes the level past the base of the tower the node is moved to a
+	taller one, as if inserted with the count as its weight.  Returns the
+	node, which may have moved.
+	*/
+	Node *adapt(Node *n)
+	{
+		++accesses;
+
+		size_t hits = access_level(n);
+		if (hits >= 31 || (random.next() & ((1u << hits) - 1)) != 0) return n;
+
+		counts(n).rank = epoch + (unsigned int)hits + 1;
+
+		size_t base = hits + 2;
+		if (base <= counts(n).base) return n;
+
+		counts(n).base = (unsigned int)base;
+		size_t new_level = tower_level(base);
+		if (new_level <= n->level) return n;
+
+		return relevel(n->key, new_level);
+	}
+
+	/*
+	Start a new epoch, and lower the towers of nodes whose decayed counts
+	have dropped to a quarter or less of what their towers were built for.
+	This is one pass along the bottom level, keeping the last node seen at
+	each level so the links past a shortened tower can be rejoined, and it
+	runs once per count accesses, so costs O(1) per access.  Links which
+	are already right are not written.
+	*/
+	void cool()
+	{
+		accesses = 0;
+		++epoch;
+		++version;
+
+		Node **last = (Node **)alloca(level * sizeof(Node *));
+		for (size_t i = 0; i < level; ++i) last[i] = head;
+
+		Node *n = head->next(0);
+		while (n) {
+			Node *next = n->next(0);
+
+			size_t base = access_level(n) + 1;
+			if (base + 1 < counts(n).base) {
+				counts(n).base = (unsigned int)base;
+
+				size_t new_level = tower_level(base);
+				if (new_level < n->level) n = move_node(n, new_level);
+			}
+
+			for (size_t i = 0; i < n->level; ++i) {
+				if (last[i]->next(i) != n) last[i]->next(i) = n;
+				last[i] = n;
+			}
+
+			n = next;
+		}
+
+		for (size_t i = 0; i < level; ++i) last[i]->next(i) = 0;
+	}
+};
+
+//Cursor for finger searches on one skip list.  Holds the predecessor at
+//each level of the last key looked up or inserted through it, and is only
+//valid while the list lives.  Any number of fingers may insert into the
+//same list, but a remove, a reweight or a tower moved by self-adjustment
+//sends their next search back to the head.
+template<class K, class V, class Random> class BiasedSkiplist<K, V, Random>::Finger {
+
+public:
+
+	Finger(const BiasedSkiplist &list) : pred(list.max_level, list.head), version(0)
+	{
+	}
+
+private:
+
+	friend class BiasedSkiplist;
+
+	std::vector<Node *> pred;
+	uint64_t version;
 };
 
 #endif
@@ -23,10 +23,17 @@ THE SOFTWARE.
 #ifndef BIASED_TREAP_H_
 #define BIASED_TREAP_H_
 
+#include <algorithm>
 #include <cstdlib>
-#include <cmath>
+#include <cstring>
 #include <fstream>
+#include <iterator>
 #include <limits>
+#include <vector>
+
+#include "key_prefix.h"
+#include "node_arena.h"
+#include "random.h"
 
 /*
 Treap implementation for weighted / biased searches.
@@ -34,44 +41,100 @@ Treap implementation for weighted / biased searches.
 Based upon the description in:
 Seidel, R., Aragon, C. R. (1996) Randomized Search Trees.  Algorithmica,
 Vol. 16, Number 4/5, pp. 464--497.  
+
+Random is the random number policy, see random.h.  Set operations which
+use several threads are in parallel_biased_treap.h.
 */
 
-template<class K, class V> class BiasedTreap {
+template<class K, class V> class FrozenBiasedTreap;
+template<class K, class V, class Random> class ParallelBiasedTreap;
+
+template<class K, class V, class Random = XorShiftRandom> class BiasedTreap {
 
 public:
 
-    BiasedTreap(bool self_adjust) : root(0), self_adjust(self_adjust)
+    //STATIC keeps the priorities drawn from the weights.  SELF_ADJUST draws a
+    //new random priority on every hit and keeps it if higher.  ADAPTIVE
+    //ranks keys by decayed, approximate access counts, see adapt().
+    enum Mode {
+        STATIC,
+        SELF_ADJUST,
+        ADAPTIVE
+    };
+
+    BiasedTreap(bool self_adjust, uint64_t seed = DEFAULT_RANDOM_SEED) : store(new Store), nodes(store->nodes), root(NIL), mode(self_adjust ? SELF_ADJUST : STATIC), epoch(0), accesses(0), random(seed)
+    { 
+    } 
+
+    BiasedTreap(Mode mode, uint64_t seed = DEFAULT_RANDOM_SEED) : store(new Store), nodes(store->nodes), root(NIL), mode(mode), epoch(0), accesses(0), random(seed)
+    { 
+    } 
+
+    //an empty treap which keeps its nodes in the arena of sibling, so
+    //split, join and unite between the two move nodes instead of copying
+    //them.  Treaps sharing an arena must not be changed from different
+    //threads at the same time.
+    BiasedTreap(Mode mode, BiasedTreap &sibling, uint64_t seed = DEFAULT_RANDOM_SEED) : store(sibling.store), nodes(store->nodes), root(NIL), mode(mode), epoch(0), accesses(0), random(seed)
     { 
+        ++store->refs;
     } 
 
+    //copies get an arena of their own
+    BiasedTreap(const BiasedTreap &other) : store(new Store), nodes(store->nodes), root(NIL), mode(other.mode), epoch(other.epoch), accesses(other.accesses), random(other.random)
+    {
+        root = clone(other, other.root, NIL);
+    }
+
+    BiasedTreap &operator=(const BiasedTreap &other)
+    {
+        if (&other != this) {
+            reset();
+            mode = other.mode;
+            epoch = other.epoch;
+            accesses = other.accesses;
+            random = other.random;
+            root = clone(other, other.root, NIL);
+        }
+
+        return *this;
+    }
+
+    //the last treap using an arena frees it a chunk at a time, the others
+    //hand their nodes back to it
     virtual ~BiasedTreap()
     { 
+        if (--store->refs == 0) delete store;
+        else clear_nodes(root);
     }
 
     void insert(const K &key, const V &value, size_t weight)
     { 
         if (!root) {
-            root = new Node(key, value, weight, 0); 
+            root = allocate(key, value, weight, NIL); 
         } else {
 
             //insert in tree based on key
-            Node *n = root; 
+            KeyPrefix prefix = key_prefix(key);
+            Index n = root; 
             while (true) {
 
-                if (key < n->key) {
-                    if (n->left) { 
-                        n = n->left;
+                int c = compare(key, prefix, n);
+                if (c < 0) {
+                    if (nodes[n].left) { 
+                        n = nodes[n].left;
                     } else {
-                        n->left = new Node(key, value, weight, n); 
-                        n = n->left;
+                        Index t = allocate(key, value, weight, n); 
+                        nodes[n].left = t;
+                        n = t;
                         break;
                     }
-                } else if (n->key < key) {
-                    if (n->right) {
-                        n = n->right; 
+                } else if (c > 0) {
+                    if (nodes[n].right) {
+                        n = nodes[n].right; 
                     } else {
-                        n->right = new Node(key, value, weight, n); 
-                        n = n->right;
+                        Index t = allocate(key, value, weight, n); 
+                        nodes[n].right = t;
+                        n = t;
                         break;
                     }
                 } else {
@@ -81,41 +144,90 @@ public:
             }
 
             //re-balance based on priorities 
-            while (n->parent && n->parent->priority < n->priority) { 
-                if (n->parent->left == n) {
-                    rotate_right(n->parent);
+            while (nodes[n].parent && nodes[nodes[n].parent].priority < nodes[n].priority) { 
+                if (nodes[nodes[n].parent].left == n) {
+                    rotate_right(nodes[n].parent);
                 } else {
-                    rotate_left(n->parent); 
+                    rotate_left(nodes[n].parent); 
                 } 
             }
         } 
     }
 
-    V *find(const K &key)
+    //entry for build, any type with key, value and weight members will do
+    struct Item {
+        K key;
+        V value;
+        size_t weight;
+    };
+
+    //replace the contents of the treap with the items in [first, last), which
+    //must be sorted by key.  Priorities are drawn from the weights as in
+    //insert and the treap is built in linear time as a Cartesian tree, keeping
+    //the right spine on a stack.  Only the first of equal keys is kept.
+    template<class Iterator> void build(Iterator first, Iterator last)
+    {
+        reset();
+
+        std::vector<Index> spine;
+        for (Iterator i = first; i != last; ++i) {
+            if (!spine.empty() && !(nodes[spine.back()].key < i->key)) continue;
+
+            Index n = allocate(i->key, i->value, i->weight, NIL);
+
+            //nodes of lower priority on the spine become the left subtree of n
+            Index last_popped = NIL;
+            while (!spine.empty() && nodes[spine.back()].priority < nodes[n].priority) {
+                last_popped = spine.back();
+                spine.pop_back();
+            }
+
+            nodes[n].left = last_popped;
+            if (last_popped) nodes[last_popped].parent = n;
+
+            if (!spine.empty()) {
+                nodes[spine.back()].right = n;
+                nodes[n].parent = spine.back();
+            }
+
+            spine.push_back(n);
+        }
+
+        if (!spine.empty()) root = spine.front();
+    }
+
+    //Q can be any type ordered against K, e.g. a string view for string keys.
+    //The value pointer stays valid until its key is removed or the treap is
+    //rebuilt, as nodes never move.
+    template<class Q> V *find(const Q &key)
     {
         V *result = 0;
 
-        Node *n = root; 
+        KeyPrefix prefix = key_prefix(key);
+        Index n = root; 
         while (n && !result) {
-            if (key < n->key) {
-                n = n->left;
-            } else if (n->key < key) { 
-                n = n->right; 
+            int c = compare(key, prefix, n);
+            if (c < 0) {
+                n = nodes[n].left;
+            } else if (c > 0) { 
+                n = nodes[n].right; 
             } else {
-                result = &n->value;
+                result = &nodes[n].value;
 
                 //if adapting weights, generate a new priority and adjust treap
-                if (self_adjust) {
-                    float t = (float)rand()/(float)RAND_MAX;
-                    if (t > n->priority) {
-                        n->priority = t;
+                if (mode == ADAPTIVE) {
+                    adapt(n);
+                } else if (mode == SELF_ADJUST) {
+                    Priority t = float_priority(random_log2(random.next()));
+                    if (t > nodes[n].priority) {
+                        nodes[n].priority = t;
 
                         //re-balance based on priorities 
-                        while (n->parent && n->parent->priority < n->priority) { 
-                            if (n->parent->left == n) {
-                                rotate_right(n->parent);
+                        while (nodes[n].parent && nodes[nodes[n].parent].priority < nodes[n].priority) { 
+                            if (nodes[nodes[n].parent].left == n) {
+                                rotate_right(nodes[n].parent);
                             } else {
-                                rotate_left(n->parent); 
+                                rotate_left(nodes[n].parent); 
                             } 
                         } 
                     }
@@ -126,38 +238,267 @@ public:
         return result; 
     }
 
-    void remove(const K &key)
+    template<class Q> void remove(const Q &key)
     { 
-        Node *n = root; 
+        KeyPrefix prefix = key_prefix(key);
+        Index n = root; 
         while (n) {
-            if (key < n->key) {
-                n = n->left;
-            } else if (n->key < key) { 
-                n = n->right; 
+            int c = compare(key, prefix, n);
+            if (c < 0) {
+                n = nodes[n].left;
+            } else if (c > 0) { 
+                n = nodes[n].right; 
             } else {
     
                 //we are a leaf, so it is safe to delete 
-                if (n->left == 0 && n->right ==0) {
-                    if (n->parent) {
-                        if (n->parent->left == n) n->parent->left = 0;
-                        else if (n->parent->right == n) n->parent->right = 0;
+                Node &node = nodes[n];
+                if (node.left == NIL && node.right == NIL) {
+                    if (node.parent) {
+                        if (nodes[node.parent].left == n) nodes[node.parent].left = NIL;
+                        else if (nodes[node.parent].right == n) nodes[node.parent].right = NIL;
                     } else {
-                        root = 0;
+                        root = NIL;
                     }
 
-                    delete n;
+                    release(n);
                     break;
                 }  
       
-                //rotate down to leaf
-                if (n->left && !n->right) rotate_right(n); 
-                else if (!n->left && n->right) rotate_left(n); 
-                else if (n->left->priority < n->right->priority) rotate_right(n);
-                else rotate_left(n); 
+                //rotate down to leaf, lifting the child of higher priority
+                if (node.left && !node.right) rotate_right(n); 
+                else if (!node.left && node.right) rotate_left(n); 
+                else if (nodes[node.left].priority < nodes[node.right].priority) rotate_left(n);
+                else rotate_right(n); 
             }
         } 
     }
 
+    //draw a new priority for key from weight and rotate the node up or down
+    //into place, without removing or reallocating it
+    template<class Q> void reweight(const Q &key, size_t weight)
+    {
+        KeyPrefix prefix = key_prefix(key);
+        Index n = root;
+        while (n) {
+            int c = compare(key, prefix, n);
+            if (c < 0) {
+                n = nodes[n].left;
+            } else if (c > 0) {
+                n = nodes[n].right;
+            } else {
+                nodes[n].priority = weight_priority(weight);
+
+                //rotate up past parents of lower priority
+                while (nodes[n].parent && nodes[nodes[n].parent].priority < nodes[n].priority) { 
+                    if (nodes[nodes[n].parent].left == n) {
+                        rotate_right(nodes[n].parent);
+                    } else {
+                        rotate_left(nodes[n].parent); 
+                    } 
+                }
+
+                //rotate down below children of higher priority
+                while (true) {
+                    Index l = nodes[n].left;
+                    Index r = nodes[n].right;
+                    Index child = l;
+                    if (!child || (r && nodes[l].priority < nodes[r].priority)) child = r;
+                    if (!child || !(nodes[n].priority < nodes[child].priority)) break;
+
+                    if (child == l) rotate_right(n);
+                    else rotate_left(n);
+                }
+
+                break;
+            }
+        }
+    }
+
+    //move all keys not less than key into greater, replacing its contents.
+    //The split takes one descent, and if greater shares the arena of this
+    //treap that is all.  Otherwise the moved nodes have to be copied into
+    //the arena of greater.
+    void split(const K &key, BiasedTreap &greater)
+    {
+        if (&greater == this) return;
+
+        Index l, r, dup = NIL;
+        split_node(root, key, l, r, dup);
+        if (dup) r = merge(dup, r);
+
+        root = l;
+        if (root) nodes[root].parent = NIL;
+
+        greater.reset();
+        if (!r) return;
+
+        if (greater.store == store) {
+            greater.root = r;
+            nodes[r].parent = NIL;
+        } else {
+            greater.root = greater.clone(*this, r, NIL);
+            clear_nodes(r);
+        }
+    }
+
+    //append other, whose keys must all be greater than the keys in this treap,
+    //leaving other empty.  Nodes are only copied if other has its own arena.
+    void join(BiasedTreap &other)
+    {
+        if (&other == this || !other.root) return;
+
+        root = merge(root, adopt(other));
+        nodes[root].parent = NIL;
+    }
+
+    //add every key of other not already present, other is left unchanged.
+    //Once the nodes of other are copied in, the two trees are combined by
+    //splitting on the root of higher priority and combining the subtrees
+    //on either side.
+    void union_with(const BiasedTreap &other)
+    {
+        if (&other == this || !other.root) return;
+
+        std::vector<Index> discarded;
+        root = union_nodes(root, clone(other, other.root, NIL), discarded);
+        nodes[root].parent = NIL;
+
+        release(discarded);
+    }
+
+    //as union_with, but takes the nodes of other and leaves it empty, so
+    //no copying is needed if other shares the arena of this treap
+    void unite(BiasedTreap &other)
+    {
+        if (&other == this || !other.root) return;
+
+        std::vector<Index> discarded;
+        root = union_nodes(root, adopt(other), discarded);
+        nodes[root].parent = NIL;
+
+        release(discarded);
+    }
+
+    //remove every key in [lo, hi)
+    void erase_range(const K &lo, const K &hi)
+    {
+        clear_nodes(cut_range(lo, hi));
+    }
+
+    //in-order position in the treap, see the definition below
+    class iterator;
+
+    iterator begin()
+    {
+        return iterator(this, root ? leftmost(root) : NIL);
+    }
+
+    iterator end()
+    {
+        return iterator(this, NIL);
+    }
+
+    //first key not less than key, in one descent and without adjusting
+    //priorities
+    template<class Q> iterator lower_bound(const Q &key)
+    {
+        KeyPrefix prefix = key_prefix(key);
+        Index result = NIL;
+        Index n = root;
+        while (n) {
+            if (compare(key, prefix, n) <= 0) {
+                result = n;
+                n = nodes[n].left;
+            } else {
+                n = nodes[n].right;
+            }
+        }
+
+        return iterator(this, result);
+    }
+
+    //first key greater than key
+    template<class Q> iterator upper_bound(const Q &key)
+    {
+        KeyPrefix prefix = key_prefix(key);
+        Index result = NIL;
+        Index n = root;
+        while (n) {
+            if (compare(key, prefix, n) < 0) {
+                result = n;
+                n = nodes[n].left;
+            } else {
+                n = nodes[n].right;
+            }
+        }
+
+        return iterator(this, result);
+    }
+
+    //call f(key, value) for every key in [lo, hi) in order, e.g. lo "ab"
+    //and hi "ac" for all keys starting with "ab".  f must not change the
+    //treap.
+    template<class L, class H, class F> void for_each_in_range(const L &lo, const H &hi, F f)
+    {
+        for (iterator i = lower_bound(lo); i != end() && i.key() < hi; ++i) {
+            f(i.key(), i.value());
+        }
+    }
+
+    //read-only copy of the treap for lookups between reloads, see
+    //FrozenBiasedTreap.  Later changes to the treap are not reflected in it.
+    FrozenBiasedTreap<K, V> freeze() const
+    {
+        FrozenBiasedTreap<K, V> frozen;
+        if (!root) return frozen;
+
+        //collect the nodes in preorder, then order them by decreasing
+        //priority.  The sort is stable so a parent still comes before a
+        //child of equal priority and the root ends up first.
+        std::vector<Index> order;
+        std::vector<Index> stack(1, root);
+        while (!stack.empty()) {
+            Index n = stack.back();
+            stack.pop_back();
+            order.push_back(n);
+            if (nodes[n].right) stack.push_back(nodes[n].right);
+            if (nodes[n].left) stack.push_back(nodes[n].left);
+        }
+
+        std::stable_sort(order.begin(), order.end(), PriorityGreater(nodes));
+
+        std::vector<Index> position(nodes.size(), 0);
+        for (size_t i = 0; i < order.size(); ++i) position[order[i]] = i;
+
+        frozen.entries.reserve(order.size());
+        frozen.values.reserve(order.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            const Node &node = nodes[order[i]];
+            typename FrozenBiasedTreap<K, V>::Entry entry = {node.key, node.prefix, position[node.left], position[node.right]};
+            frozen.entries.push_back(entry);
+            frozen.values.push_back(node.value);
+        }
+
+        return frozen;
+    }
+
+    //number of nodes above key, without adjusting priorities
+    template<class Q> bool depth(const Q &key, size_t &d) const
+    {
+        KeyPrefix prefix = key_prefix(key);
+        Index n = root;
+        d = 0;
+        while (n) {
+            int c = compare(key, prefix, n);
+            if (c == 0) return true;
+
+            n = c < 0 ? nodes[n].left : nodes[n].right;
+            ++d;
+        }
+
+        return false;
+    }
+
     void render_tree(const char *filename)
     {
         std::ofstream o(filename);
@@ -174,68 +515,644 @@ public:
 
 private:
 
+    friend class ParallelBiasedTreap<K, V, Random>;
+
+    //priorities are compared as 64 bit integers, see weight_priority.  The
+    //mode is chosen at run time so every node has the width adaptive
+    //priorities need, but the node keeps it next to the key prefix, so a
+    //small value packs with the indices rather than leaving a hole before
+    //the priority.  <std::string, int> and <int, int> nodes stay at 64 and
+    //40 bytes, as they were with 32 bit float priorities.
+    typedef uint64_t Priority;
+
+    //nodes refer to each other by 32 bit index into the arena rather than by
+    //pointer, index 0 is the null node
+    typedef unsigned int Index;
+    static const Index NIL = 0;
+
     struct Node {
         K key;
+        KeyPrefix prefix;
+        Priority priority;
         V value; 
-        float priority;
-        Node *parent;
-        Node *left;
-        Node *right;
+        Index parent;
+        Index left;
+        Index right;
 
-        Node(const K &key, const V &value, size_t weight, Node *parent) : key(key), value(value), parent(parent)
+        Node() : key(), prefix(0), priority(0), value(), parent(NIL), left(NIL), right(NIL)
         {
-            left = right = 0;
-            if (weight == 0) weight = 1;
-            priority = pow((float)rand()/(float)RAND_MAX, 1.0/(float)weight); 
-        } 
+        }
+    };
+
+    //all nodes live in one arena which is freed in one go with the last
+    //treap using it, removed nodes are chained through their left index
+    //for reuse
+    struct Store {
+        NodeArena<Node, Index> nodes;
+        Index free_list;
+        size_t refs;
+
+        Store() : free_list(NIL), refs(1)
+        {
+            //slot 0 is the null node
+            nodes.push_back(Node());
+        }
+    };
+
+    Store *store;
+    NodeArena<Node, Index> &nodes;
+    Index root;
+    Mode mode;
+
+    //adaptive mode state, the epoch advances once per node count accesses
+    unsigned int epoch;
+    size_t accesses;
+
+    Random random;
+
+    //sign of key against the key of node n.  The inline prefixes settle
+    //most compares without reading the node's key.
+    template<class Q> int compare(const Q &key, KeyPrefix prefix, Index n) const
+    {
+        const Node &node = nodes[n];
+        if (KeyPrefixesComparable<Q, K>::value && prefix != node.prefix) return prefix < node.prefix ? -1 : 1;
+        if (key < node.key) return -1;
+        if (node.key < key) return 1;
+        return 0;
+    }
+
+    Index leftmost(Index n) const
+    {
+        while (nodes[n].left) n = nodes[n].left;
+        return n;
+    }
+
+    Index rightmost(Index n) const
+    {
+        while (nodes[n].right) n = nodes[n].right;
+        return n;
+    }
+
+    //next node in order, walking down the right subtree or else up to the
+    //first ancestor reached from its left
+    Index successor(Index n) const
+    {
+        if (nodes[n].right) return leftmost(nodes[n].right);
+
+        Index p = nodes[n].parent;
+        while (p && nodes[p].right == n) {
+            n = p;
+            p = nodes[p].parent;
+        }
+
+        return p;
+    }
+
+    Index predecessor(Index n) const
+    {
+        if (nodes[n].left) return rightmost(nodes[n].left);
+
+        Index p = nodes[n].parent;
+        while (p && nodes[p].left == n) {
+            n = p;
+            p = nodes[p].parent;
+        }
+
+        return p;
+    }
+
+    //orders node indices by decreasing priority for freeze
+    struct PriorityGreater {
+        const NodeArena<Node, Index> &nodes;
+
+        PriorityGreater(const NodeArena<Node, Index> &nodes) : nodes(nodes)
+        {
+        }
+
+        bool operator()(Index a, Index b) const
+        {
+            return nodes[b].priority < nodes[a].priority;
+        }
     };
 
-    Node *root;
-    bool self_adjust;
+    //write a node and its subtrees in graphviz dot format
+    void render_node(std::ofstream &o, Index n)
+    {
+        if (!n) return;
+
+        o << "\"" << nodes[n].key << "\" [label=\"" << nodes[n].key << "\\n" << nodes[n].priority << "\"];\n";
+
+        if (nodes[n].left) {
+            o << "\"" << nodes[n].key << "\" -> \"" << nodes[nodes[n].left].key << "\";\n";
+            render_node(o, nodes[n].left);
+        }
+
+        if (nodes[n].right) {
+            o << "\"" << nodes[n].key << "\" -> \"" << nodes[nodes[n].right].key << "\";\n";
+            render_node(o, nodes[n].right);
+        }
+    }
+
+    Index new_node()
+    {
+        Index n;
+        if (store->free_list) {
+            n = store->free_list;
+            store->free_list = nodes[n].left;
+        } else {
+            n = (Index)nodes.size();
+            nodes.push_back(Node());
+        }
+
+        return n;
+    }
+
+    Index allocate(const K &key, const V &value, size_t weight, Index parent)
+    {
+        Index n = new_node();
+
+        Node &node = nodes[n];
+        node.key = key;
+        node.prefix = key_prefix(key);
+        node.value = value;
+        node.parent = parent;
+        node.left = node.right = NIL;
+        node.priority = weight_priority(weight);
+
+        return n;
+    } 
+
+    //priority for a key of the given weight.  Normally this is the largest
+    //of weight uniform random numbers, so heavier keys tend to sit nearer
+    //the root.  That is u^(1/weight) for one uniform u, and it is kept as
+    //log2(u)/weight to avoid a pow.  random_log2 is only piecewise linear,
+    //up to 0.09 out, so keys of different weights are ordered close to but
+    //not exactly as u^(1/weight) would order them; keys of equal weight
+    //keep the exact order of their draws.  The float is kept as an integer
+    //of the same order.  In adaptive mode the weight gives the starting
+    //access level.
+    Priority weight_priority(size_t weight)
+    {
+        if (weight == 0) weight = 1;
+
+        if (mode == ADAPTIVE) {
+            size_t level = weight_level(weight) - 1;
+            return adaptive_priority(epoch + level, random.next());
+        }
+
+        return float_priority(random_log2(random.next()) / (float)weight); 
+    }
+
+    //map a float onto an integer which orders the same way: flip every bit
+    //of negative floats, so larger magnitudes come first, and the sign bit
+    //of the others, so they come after the negative ones
+    static Priority float_priority(float p)
+    {
+        uint32_t bits;
+        memcpy(&bits, &p, sizeof(bits));
+        return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+    }
+
+    static Priority adaptive_priority(uint64_t rank, uint32_t tiebreak)
+    {
+        return (rank << 32) | tiebreak;
+    }
+
+    /*
+    In adaptive mode a priority holds a rank in its high 32 bits and a fixed
+    random tiebreak in the low 32, so neither loses bits to the other.  The
+    rank is the epoch of the last update plus the log of an approximate
+    access count, kept as a Morris counter: a hit bumps the level with
+    probability 2^-level.  Measured against the current epoch, levels of
+    untouched nodes all drop by one per epoch, which halves their counts
+    without writing to them and lets cooling keys sink below warmer ones.
+    Most hits leave the node alone, and the treap is only rotated when a
+    level actually goes up.
+    */
+    void adapt(Index n)
+    {
+        if (++accesses >= nodes.size()) {
+            accesses = 0;
+            ++epoch;
+        }
+
+        uint64_t rank = nodes[n].priority >> 32;
+        long level = (long)rank - (long)epoch;
+        if (level < 0) level = 0;
+        //a level of 31 or more is never bumped and a level of 0 always
+        //is, so only draw a random number when the outcome is in doubt
+        if (level >= 31) return;
+        if (level > 0 && (random.next() & ((1u << level) - 1)) != 0) return;
+
+        nodes[n].priority = adaptive_priority(epoch + level + 1, (uint32_t)nodes[n].priority);
+
+        while (nodes[n].parent && nodes[nodes[n].parent].priority < nodes[n].priority) { 
+            if (nodes[nodes[n].parent].left == n) {
+                rotate_right(nodes[n].parent);
+            } else {
+                rotate_left(nodes[n].parent); 
+            } 
+        }
+    }
+
+    void release(Index n)
+    {
+        //drop any memory held by the key and value
+        nodes[n] = Node();
+        nodes[n].left = store->free_list;
+        store->free_list = n;
+    }
+
+    void release(const std::vector<Index> &released)
+    {
+        for (size_t i = 0; i < released.size(); ++i) release(released[i]);
+    }
+
+    //empty the treap, and its arena unless that is shared
+    void reset()
+    {
+        if (store->refs == 1) {
+            nodes.clear();
+            nodes.push_back(Node());
+            store->free_list = NIL;
+        } else {
+            clear_nodes(root);
+        }
+
+        root = NIL;
+    }
+
+    //the nodes of other as a subtree of this arena, leaving other empty
+    Index adopt(BiasedTreap &other)
+    {
+        Index t;
+        if (other.store == store) {
+            t = other.root;
+            other.root = NIL;
+        } else {
+            t = clone(other, other.root, NIL);
+            other.reset();
+        }
+
+        return t;
+    }
+
+    void set_left(Index p, Index c)
+    {
+        nodes[p].left = c;
+        if (c) nodes[c].parent = p;
+    }
+
+    void set_right(Index p, Index c)
+    {
+        nodes[p].right = c;
+        if (c) nodes[c].parent = p;
+    }
+
+    //copy subtree t of from into this arena, keeping shape and priorities
+    Index clone(const BiasedTreap &from, Index t, Index parent)
+    {
+        if (!t) return NIL;
+
+        Index n = new_node();
+        nodes[n].key = from.nodes[t].key;
+        nodes[n].prefix = from.nodes[t].prefix;
+        nodes[n].value = from.nodes[t].value;
+        nodes[n].priority = from.nodes[t].priority;
+        nodes[n].parent = parent;
+
+        Index l = clone(from, from.nodes[t].left, n);
+        nodes[n].left = l;
+        Index r = clone(from, from.nodes[t].right, n);
+        nodes[n].right = r;
+
+        return n;
+    }
+
+    //split subtree t into keys less than key (l) and greater than key (r),
+    //a node equal to key is detached into dup.  The parents of l and r are
+    //left for the caller to set.
+    void split_node(Index t, const K &key, Index &l, Index &r, Index &dup)
+    {
+        if (!t) {
+            l = r = NIL;
+        } else if (nodes[t].key < key) {
+            Index rl;
+            split_node(nodes[t].right, key, rl, r, dup);
+            set_right(t, rl);
+            l = t;
+        } else if (key < nodes[t].key) {
+            Index lr;
+            split_node(nodes[t].left, key, l, lr, dup);
+            set_left(t, lr);
+            r = t;
+        } else {
+            l = nodes[t].left;
+            r = nodes[t].right;
+            nodes[t].left = nodes[t].right = NIL;
+            dup = t;
+        }
+    }
+
+    //join subtrees where every key in a is less than every key in b
+    Index merge(Index a, Index b)
+    {
+        if (!a) return b;
+        if (!b) return a;
+
+        if (nodes[a].priority > nodes[b].priority) {
+            set_right(a, merge(nodes[a].right, b));
+            return a;
+        } else {
+            set_left(b, merge(a, nodes[b].left));
+            return b;
+        }
+    }
+
+    //detach the keys in [lo, hi) and return them as a subtree
+    Index cut_range(const K &lo, const K &hi)
+    {
+        if (!(lo < hi)) return NIL;
+
+        Index l, m, r, dup = NIL;
+        split_node(root, lo, l, m, dup);
+        if (dup) m = merge(dup, m);
+
+        Index mid;
+        dup = NIL;
+        split_node(m, hi, mid, r, dup);
+        if (dup) r = merge(dup, r);
+
+        root = merge(l, r);
+        if (root) nodes[root].parent = NIL;
+
+        return mid;
+    }
+
+    //one step of a union: the root of higher priority of a and b is kept,
+    //and the other subtree is split around its key.  This leaves pairs of
+    //subtrees to combine on either side.  On duplicate keys the value from
+    //a is kept and the other node is added to discarded.
+    Index union_split(Index a, Index b, Index &left_a, Index &left_b, Index &right_a, Index &right_b, std::vector<Index> &discarded)
+    {
+        Index root, dup = NIL;
+        if (nodes[a].priority >= nodes[b].priority) {
+            root = a;
+            left_a = nodes[a].left;
+            right_a = nodes[a].right;
+            split_node(b, nodes[a].key, left_b, right_b, dup);
+        } else {
+            root = b;
+            left_b = nodes[b].left;
+            right_b = nodes[b].right;
+            split_node(a, nodes[b].key, left_a, right_a, dup);
+            if (dup) std::swap(nodes[root].value, nodes[dup].value);
+        }
+        if (dup) discarded.push_back(dup);
+
+        return root;
+    }
+
+    //union of subtree a from this treap and subtree b taken from another
+    Index union_nodes(Index a, Index b, std::vector<Index> &discarded)
+    {
+        if (!a) return b;
+        if (!b) return a;
+
+        Index left_a, left_b, right_a, right_b;
+        Index root = union_split(a, b, left_a, left_b, right_a, right_b, discarded);
+
+        set_left(root, union_nodes(left_a, left_b, discarded));
+        set_right(root, union_nodes(right_a, right_b, discarded));
+        return root;
+    }
+
+    //drop the keys and values of subtree t, collecting its nodes in released
+    void destroy_nodes(Index t, std::vector<Index> &released)
+    {
+        if (!t) return;
+
+        Index left = nodes[t].left;
+        Index right = nodes[t].right;
+        nodes[t] = Node();
+        released.push_back(t);
+
+        destroy_nodes(left, released);
+        destroy_nodes(right, released);
+    }
+
+    //free every node of subtree t
+    void clear_nodes(Index t)
+    {
+        std::vector<Index> released;
+        destroy_nodes(t, released);
+        recycle(released);
+    }
+
+    //chain nodes already emptied by destroy_nodes onto the free list
+    void recycle(const std::vector<Index> &released)
+    {
+        for (size_t i = 0; i < released.size(); ++i) {
+            nodes[released[i]].left = store->free_list;
+            store->free_list = released[i];
+        }
+    }
 
     // [T, T->left, T->left->right] <- [T->left, T->left->right, T]
-    void rotate_right(Node *n)
+    void rotate_right(Index n)
     {
-        Node *nl = n->left;
+        Index nl = nodes[n].left;
 
-        nl->parent = n->parent; 
+        nodes[nl].parent = nodes[n].parent; 
 
-        if (nl->parent != 0) {
-            if (nl->parent->left == n) nl->parent->left = nl;
-            else nl->parent->right = nl; 
+        if (nodes[nl].parent != NIL) {
+            if (nodes[nodes[nl].parent].left == n) nodes[nodes[nl].parent].left = nl;
+            else nodes[nodes[nl].parent].right = nl; 
         } else {
             root = nl;
         }
 
-        n->left = nl->right;
-        if (n->left != 0) n->left->parent = n;
+        nodes[n].left = nodes[nl].right;
+        if (nodes[n].left != NIL) nodes[nodes[n].left].parent = n;
 
-        n->parent = nl;
-        nl->right = n; 
+        nodes[n].parent = nl;
+        nodes[nl].right = n; 
     } 
 
     // [T, T->right, T->right->left] <- [T->right, T->right->left, T]
-    void rotate_left(Node *n)
+    void rotate_left(Index n)
     { 
-        Node *nr = n->right;
+        Index nr = nodes[n].right;
 
-        nr->parent = n->parent; 
+        nodes[nr].parent = nodes[n].parent; 
 
-        if (nr->parent != 0) {
-            if (nr->parent->left == n) nr->parent->left = nr;
-            else nr->parent->right = nr; 
+        if (nodes[nr].parent != NIL) {
+            if (nodes[nodes[nr].parent].left == n) nodes[nodes[nr].parent].left = nr;
+            else nodes[nodes[nr].parent].right = nr; 
         } else {
             root = nr;
         }
 
-        n->right = nr->left;
-        if (n->right != 0) n->right->parent = n;
+        nodes[n].right = nodes[nr].left;
+        if (nodes[n].right != NIL) nodes[nodes[n].right].parent = n;
+
+        nodes[n].parent = nr;
+        nodes[nr].left = n;
+    }
+};
+
+//Bidirectional in-order iterator.  It dereferences to the value, the key
+//is read with key().  Decrementing end() gives the largest key.  Rotations
+//keep the order of the nodes, so an iterator survives inserts and
+//self-adjusting lookups, but not the removal of its own key or the calls
+//which rebuild the treap.
+template<class K, class V, class Random> class BiasedTreap<K, V, Random>::iterator {
+
+public:
+
+    typedef std::bidirectional_iterator_tag iterator_category;
+    typedef V value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef V *pointer;
+    typedef V &reference;
+
+    iterator() : treap(0), n(NIL)
+    {
+    }
+
+    const K &key() const
+    {
+        return treap->nodes[n].key;
+    }
+
+    V &value() const
+    {
+        return treap->nodes[n].value;
+    }
+
+    V &operator*() const
+    {
+        return treap->nodes[n].value;
+    }
+
+    V *operator->() const
+    {
+        return &treap->nodes[n].value;
+    }
+
+    iterator &operator++()
+    {
+        n = treap->successor(n);
+        return *this;
+    }
+
+    iterator operator++(int)
+    {
+        iterator t = *this;
+        ++*this;
+        return t;
+    }
+
+    iterator &operator--()
+    {
+        if (n) n = treap->predecessor(n);
+        else if (treap->root) n = treap->rightmost(treap->root);
+        return *this;
+    }
+
+    iterator operator--(int)
+    {
+        iterator t = *this;
+        --*this;
+        return t;
+    }
+
+    bool operator==(const iterator &other) const
+    {
+        return n == other.n;
+    }
+
+    bool operator!=(const iterator &other) const
+    {
+        return n != other.n;
+    }
+
+private:
+
+    friend class BiasedTreap;
+
+    BiasedTreap *treap;
+    Index n;
 
-        n->parent = nr;
-        nr->left = n;
+    iterator(BiasedTreap *treap, Index n) : treap(treap), n(n)
+    {
     }
 };
 
-#endif 
+/*
+Immutable snapshot of a biased treap, made by BiasedTreap::freeze.
+
+The nodes are stored contiguously in order of decreasing priority, which
+puts the heavy keys near the root on the first few cache lines and pages
+whatever their depth.  The root is entry 0, so 0 also marks a missing
+child.  Keys, their inline prefixes and child links are kept apart from
+the values so a search only touches the values on a hit.  There are no
+parent pointers or priorities and lookups never write.
+*/
 
+template<class K, class V> class FrozenBiasedTreap {
+
+public:
+
+    FrozenBiasedTreap()
+    {
+    }
+
+    template<class Q> const V *find(const Q &key) const
+    {
+        if (entries.empty()) return 0;
+
+        KeyPrefix prefix = key_prefix(key);
+        Index n = 0;
+        while (true) {
+            const Entry &entry = entries[n];
+
+            int c;
+            if (KeyPrefixesComparable<Q, K>::value && prefix != entry.prefix) c = prefix < entry.prefix ? -1 : 1;
+            else c = key < entry.key ? -1 : (entry.key < key ? 1 : 0);
+
+            if (c < 0) {
+                if (!entry.left) return 0;
+                n = entry.left;
+            } else if (c > 0) {
+                if (!entry.right) return 0;
+                n = entry.right;
+            } else {
+                return &values[n];
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return entries.size();
+    }
+
+private:
+
+    template<class, class, class> friend class BiasedTreap;
+
+    typedef unsigned int Index;
+
+    struct Entry {
+        K key;
+        KeyPrefix prefix;
+        Index left;
+        Index right;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<V> values;
+};
 
+#endif
@@ -0,0 +1,685 @@
+/*
+Copyright (c) 2011 Daniel Minor 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+
+#ifndef CONCURRENT_BIASED_HASHTABLE_H_
+#define CONCURRENT_BIASED_HASHTABLE_H_
+
+#include <pthread.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "key_hash.h"
+#include "slab_allocator.h"
+
+/*
+Thread safe version of BiasedHashtable.  Buckets are divided between a fixed
+number of stripes, each guarded by its own reader-writer lock, so finds run
+in parallel and only inserts and removes in the same stripe contend.  The
+table size is kept a multiple of the number of stripes, which means a key
+stays in the same stripe when the table grows.  Growing takes every stripe
+lock and rehashes the whole table.
+
+Since other threads may change the table at any time, find copies the value
+out while holding the lock rather than returning a pointer.
+*/
+template<class K, class V, class Hash = KeyHash, template<class> class Allocator = SlabAllocator> class ConcurrentBiasedHashtable {
+
+public:
+
+    ConcurrentBiasedHashtable(size_t initial_size, Hash hash = Hash(), size_t stripe_count = 64, float max_load = 1.0f) : count(0), stripe_count(stripe_count), hash(hash), max_load(max_load)
+    {
+        if (this->stripe_count == 0) this->stripe_count = 1;
+        size = (initial_size + this->stripe_count - 1) / this->stripe_count * this->stripe_count;
+        if (size == 0) size = this->stripe_count;
+
+        buckets = new Node *[size];
+        for (size_t i = 0; i < size; ++i) buckets[i] = 0;
+
+        stripes = new Stripe[this->stripe_count];
+        for (size_t i = 0; i < this->stripe_count; ++i) pthread_rwlock_init(&stripes[i].lock, 0);
+    }
+
+    virtual ~ConcurrentBiasedHashtable()
+    {
+        if (Allocator<Node>::NEEDS_RELEASE) {
+            for (size_t i = 0; i < size; ++i) {
+                Node *n = buckets[i];
+                while (n) {
+                    Node *t = n;
+                    n = n->next;
+                    stripes[i % stripe_count].pool.release(t);
+                }
+            }
+        }
+
+        for (size_t i = 0; i < stripe_count; ++i) pthread_rwlock_destroy(&stripes[i].lock);
+
+        delete[] buckets;
+        delete[] stripes;
+    }
+
+    void insert(const K &key, const V &value, size_t weight)
+    {
+        unsigned int h = hash(key);
+        Stripe &stripe = stripes[h % stripe_count];
+
+        pthread_rwlock_wrlock(&stripe.lock);
+
+        //find place to insert node in list
+        Node **p = &buckets[h % size];
+        while (*p && (*p)->weight > weight) p = &(*p)->next;
+
+        Node *n = stripe.pool.allocate();
+        n->key = key;
+        n->value = value;
+        n->weight = weight;
+        n->hash_value = h;
+        n->next = *p;
+        *p = n;
+
+        pthread_rwlock_unlock(&stripe.lock);
+
+        size_t c = __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+        if ((float)c > max_load * (float)__atomic_load_n(&size, __ATOMIC_RELAXED)) grow();
+    }
+
+    //Q can be any type the hash accepts and which compares equal to K
+    template<class Q> bool find(const Q &key, V &value)
+    {
+        unsigned int h = hash(key);
+        Stripe &stripe = stripes[h % stripe_count];
+        bool found = false;
+
+        pthread_rwlock_rdlock(&stripe.lock);
+
+        Node *n = buckets[h % size];
+        while (n && (n->hash_value != h || n->key != key)) n = n->next;
+
+        if (n) {
+            value = n->value;
+            found = true;
+        }
+
+        pthread_rwlock_unlock(&stripe.lock);
+
+        return found;
+    }
+
+    template<class Q> void remove(const Q &key)
+    {
+        unsigned int h = hash(key);
+        Stripe &stripe = stripes[h % stripe_count];
+
+        pthread_rwlock_wrlock(&stripe.lock);
+
+        Node **p = &buckets[h % size];
+        while (*p && ((*p)->hash_value != h || (*p)->key != key)) p = &(*p)->next;
+
+        if (*p) {
+            Node *n = *p;
+            *p = n->next;
+            stripe.pool.deallocate(n);
+            __atomic_sub_fetch(&count, 1, __ATOMIC_RELAXED);
+        }
+
+        pthread_rwlock_unlock(&stripe.lock);
+    }
+
+private:
+
+    struct Node {
+        K key;
+        V value;
+        size_t weight;
+        unsigned int hash_value;
+        Node *next;
+
+        Node() : next(0) {};
+    };
+
+    //each stripe allocates the nodes of its own buckets, padded so
+    //neighbouring locks do not share a cache line
+    struct Stripe {
+        pthread_rwlock_t lock;
+        Allocator<Node> pool;
+        char padding[64];
+    };
+
+    Node **buckets;
+    size_t count;
+    size_t size;
+    Stripe *stripes;
+    size_t stripe_count;
+    Hash hash;
+    float max_load;
+
+    void grow()
+    {
+        for (size_t i = 0; i < stripe_count; ++i) pthread_rwlock_wrlock(&stripes[i].lock);
+
+        //another thread may have grown the table while we waited
+        if ((float)__atomic_load_n(&count, __ATOMIC_RELAXED) > max_load * (float)size) {
+            size_t new_size = size * 2;
+            Node **new_buckets = new Node *[new_size];
+            for (size_t i = 0; i < new_size; ++i) new_buckets[i] = 0;
+
+            //append to the new chains so they stay in weight order
+            for (size_t i = 0; i < size; ++i) {
+                Node *n = buckets[i];
+                while (n) {
+                    Node *next = n->next;
+
+                    Node **p = &new_buckets[n->hash_value % new_size];
+                    while (*p) p = &(*p)->next;
+                    *p = n;
+                    n->next = 0;
+
+                    n = next;
+                }
+            }
+
+            delete[] buckets;
+            buckets = new_buckets;
+            __atomic_store_n(&size, new_size, __ATOMIC_RELAXED);
+        }
+
+        for (size_t i = stripe_count; i > 0; --i) pthread_rwlock_unlock(&stripes[i - 1].lock);
+    }
+};
+
+/*
+Thread safe version of SelfAdjustingBiasedHashtable.  Finds take no lock
+and never write to the table.  They walk their chain inside an epoch
+announced by their thread, as in ConcurrentBiasedSkiplist, and a node
+removed in epoch e is only freed once the global epoch has reached e + 2,
+so it stays readable for as long as a find may hold it.  Keys, values and stamps are
+not changed once a node is linked in, only next pointers.
+
+Inserting at the front of a chain or unlinking a node never hides the
+other nodes from a walk, but moving a node to the front or rehashing can.
+Those bump a version kept per stripe, odd while the change is under way,
+and a find which misses while the version moved looks again, taking the
+stripe's read lock after a few tries.
+
+A hit outside the head of its chain is logged in a buffer owned by the
+calling thread, and once the buffer fills up the thread moves the logged
+nodes to the front of their chains in one batch.  Stripes which are
+locked by someone else are skipped during the batch; the skipped hits
+stay in the buffer and are retried with the next batch.  Only if a batch
+frees no room at all does the thread wait for the locks.  Calling flush()
+applies the calling thread's pending promotions right away, waiting for
+locks, and a thread's pending hits are also applied when it exits, after
+which its buffer is handed to the next thread to use the table.
+
+Each node is stamped when it is inserted with a number unique within its
+stripe, and hits are logged by stamp rather than by pointer.  A node
+removed before its hit is applied is then simply not found, even if its
+memory has since been reused for another node.  Threads must stop using
+the table before it is destroyed.
+*/
+template<class K, class V, class Hash = KeyHash, template<class> class Allocator = SlabAllocator> class ConcurrentSelfAdjustingBiasedHashtable {
+
+public:
+
+    ConcurrentSelfAdjustingBiasedHashtable(size_t initial_size, Hash hash = Hash(), size_t stripe_count = 64, float max_load = 1.0f) : count(0), stripe_count(stripe_count), hash(hash), max_load(max_load), epoch(0), buffers(0)
+    {
+        if (this->stripe_count == 0) this->stripe_count = 1;
+        size = (initial_size + this->stripe_count - 1) / this->stripe_count * this->stripe_count;
+        if (size == 0) size = this->stripe_count;
+
+        buckets = new Node *[size];
+        for (size_t i = 0; i < size; ++i) buckets[i] = 0;
+
+        stripes = new Stripe[this->stripe_count];
+        for (size_t i = 0; i < this->stripe_count; ++i) pthread_rwlock_init(&stripes[i].lock, 0);
+
+        pthread_key_create(&buffer_key, drain_buffer);
+        pthread_mutex_init(&buffers_lock, 0);
+    }
+
+    virtual ~ConcurrentSelfAdjustingBiasedHashtable()
+    {
+        if (Allocator<Node>::NEEDS_RELEASE) {
+            for (size_t i = 0; i < size; ++i) {
+                Node *n = buckets[i];
+                while (n) {
+                    Node *t = n;
+                    n = n->next;
+                    stripes[i % stripe_count].pool.release(t);
+                }
+            }
+
+            //removed nodes still waiting for their epoch to pass
+            for (size_t i = 0; i < stripe_count; ++i) {
+                for (int j = 0; j < 3; ++j) {
+                    for (size_t k = 0; k < stripes[i].retired[j].size(); ++k) stripes[i].pool.release(stripes[i].retired[j][k]);
+                }
+            }
+        }
+
+        //every buffer ever handed out is on the list
+        while (buffers) {
+            HitBuffer *t = buffers;
+            buffers = buffers->next;
+            delete t;
+        }
+
+        pthread_key_delete(buffer_key);
+        pthread_mutex_destroy(&buffers_lock);
+
+        for (size_t i = 0; i < stripe_count; ++i) pthread_rwlock_destroy(&stripes[i].lock);
+
+        for (size_t i = 0; i < old_buckets.size(); ++i) delete[] old_buckets[i];
+        delete[] buckets;
+        delete[] stripes;
+    }
+
+    void insert(const K &key, const V &value)
+    {
+        unsigned int h = hash(key);
+        Stripe &stripe = stripes[h % stripe_count];
+
+        pthread_rwlock_wrlock(&stripe.lock);
+
+        //insert new node at front, publishing it only once it is filled in
+        Node *n = stripe.pool.allocate();
+        n->key = key;
+        n->value = value;
+        n->hash_value = h;
+        n->stamp = ++stripe.stamps;
+        n->next = buckets[h % size];
+        __atomic_store_n(&buckets[h % size], n, __ATOMIC_RELEASE);
+
+        pthread_rwlock_unlock(&stripe.lock);
+
+        size_t c = __atomic_add_fetch(&count, 1, __ATOMIC_RELAXED);
+        if ((float)c > max_load * (float)__atomic_load_n(&size, __ATOMIC_RELAXED)) grow();
+    }
+
+    template<class Q> bool find(const Q &key, V &value)
+    {
+        unsigned int h = hash(key);
+        Stripe &stripe = stripes[h % stripe_count];
+        HitBuffer *buffer = thread_buffer();
+
+        enter(buffer);
+
+        Node *head = 0;
+        Node *n = 0;
+        for (int tries = 0; ; ++tries) {
+            if (tries == OPTIMISTIC_TRIES) {
+                pthread_rwlock_rdlock(&stripe.lock);
+                n = search(h, key, head);
+                pthread_rwlock_unlock(&stripe.lock);
+                break;
+            }
+
+            uint64_t version = __atomic_load_n(&stripe.version, __ATOMIC_ACQUIRE);
+            n = search(h, key, head);
+            if (n) break;
+
+            //a miss only counts if no node was moved during the walk
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (!(version & 1) && __atomic_load_n(&stripe.version, __ATOMIC_RELAXED) == version) break;
+        }
+
+        uint64_t promote = 0;
+        if (n) {
+            value = n->value;
+            if (n != head) promote = n->stamp;
+        }
+
+        exit(buffer);
+
+        //log hit for a later move to front
+        if (promote) {
+            buffer->hits[buffer->count].stamp = promote;
+            buffer->hits[buffer->count].hash_value = h;
+            if (++buffer->count == BATCH_SIZE) {
+                apply(buffer, false);
+                if (buffer->count == BATCH_SIZE) apply(buffer, true);
+            }
+        }
+
+        return n != 0;
+    }
+
+    template<class Q> void remove(const Q &key)
+    {
+        unsigned int h = hash(key);
+        Stripe &stripe = stripes[h % stripe_count];
+
+        pthread_rwlock_wrlock(&stripe.lock);
+
+        Node **p = &buckets[h % size];
+        while (*p && ((*p)->hash_value != h || (*p)->key != key)) p = &(*p)->next;
+
+        //finds may still be reading the node, so it is only unlinked here
+        if (*p) {
+            Node *n = *p;
+            __atomic_store_n(p, n->next, __ATOMIC_RELEASE);
+            retire(stripe, n);
+            __atomic_sub_fetch(&count, 1, __ATOMIC_RELAXED);
+        }
+
+        pthread_rwlock_unlock(&stripe.lock);
+    }
+
+    //apply the calling thread's logged hits now
+    void flush()
+    {
+        apply(thread_buffer(), true);
+    }
+
+    //number of nodes ahead of key in its chain
+    template<class Q> bool depth(const Q &key, size_t &d)
+    {
+        unsigned int h = hash(key);
+        Stripe &stripe = stripes[h % stripe_count];
+        d = 0;
+
+        pthread_rwlock_rdlock(&stripe.lock);
+
+        Node *n = buckets[h % size];
+        while (n && (n->hash_value != h || n->key != key)) {
+            n = n->next;
+            ++d;
+        }
+
+        pthread_rwlock_unlock(&stripe.lock);
+
+        return n != 0;
+    }
+
+private:
+
+    struct Node {
+        K key;
+        V value;
+        unsigned int hash_value;
+        uint64_t stamp;
+        Node *next;
+
+        Node() : stamp(0), next(0) {};
+    };
+
+    //stamps counts the nodes inserted into the stripe, so is never reused.
+    //version is odd while a writer moves nodes in the stripe's chains.
+    //Removed nodes wait in retired, by epoch modulo 3, until no find can
+    //still be reading them.
+    struct Stripe {
+        pthread_rwlock_t lock;
+        Allocator<Node> pool;
+        uint64_t stamps;
+        uint64_t version;
+        std::vector<Node *> retired[3];
+        uint64_t retired_epoch[3];
+        size_t retires;
+        char padding[64];
+
+        Stripe() : stamps(0), version(0), retires(0)
+        {
+            for (int i = 0; i < 3; ++i) retired_epoch[i] = 0;
+        }
+    };
+
+    //number of hits a thread logs before applying them
+    static const size_t BATCH_SIZE = 32;
+
+    //lock-free walks a find makes before taking the read lock
+    static const int OPTIMISTIC_TRIES = 4;
+
+    //try to advance the epoch after this many removes from one stripe
+    static const size_t ADVANCE_INTERVAL = 64;
+
+    struct Hit {
+        uint64_t stamp;
+        unsigned int hash_value;
+    };
+
+    //per thread state, padded so the epochs of different threads do not
+    //share a cache line
+    struct HitBuffer {
+        char padding[64];
+
+        //epoch << 1, with the low bit set while in a find
+        uint64_t state;
+
+        Hit hits[BATCH_SIZE];
+        size_t count;
+        bool owned;
+        ConcurrentSelfAdjustingBiasedHashtable *table;
+        HitBuffer *next;
+    };
+
+    Node **buckets;
+    size_t count;
+    size_t size;
+    Stripe *stripes;
+    size_t stripe_count;
+    Hash hash;
+    float max_load;
+
+    //bucket arrays replaced by grow, which finds may still be walking.
+    //Each is half the size of the next, so together they take less room
+    //than the current one.
+    std::vector<Node **> old_buckets;
+
+    uint64_t epoch;
+
+    //per thread hit buffers, also kept on a list so the ones of threads
+    //still running can be freed, and so the epoch can be advanced
+    pthread_key_t buffer_key;
+    pthread_mutex_t buffers_lock;
+    HitBuffer *buffers;
+
+    //the node of key in its chain, and the head of that chain.  size is
+    //read before buckets, so a find racing grow may use the old size with
+    //the new array, but never the new size with the old one.
+    template<class Q> Node *search(unsigned int h, const Q &key, Node *&head)
+    {
+        size_t s = __atomic_load_n(&size, __ATOMIC_ACQUIRE);
+        Node **b = __atomic_load_n(&buckets, __ATOMIC_ACQUIRE);
+
+        head = __atomic_load_n(&b[h % s], __ATOMIC_ACQUIRE);
+        Node *n = head;
+        while (n && (n->hash_value != h || n->key != key)) n = __atomic_load_n(&n->next, __ATOMIC_ACQUIRE);
+
+        return n;
+    }
+
+    //buffer for the calling thread, which takes over the buffer of an
+    //exited thread if there is one
+    HitBuffer *thread_buffer()
+    {
+        HitBuffer *buffer = (HitBuffer *)pthread_getspecific(buffer_key);
+        if (!buffer) {
+            pthread_mutex_lock(&buffers_lock);
+
+            buffer = buffers;
+            while (buffer && buffer->owned) buffer = buffer->next;
+
+            if (!buffer) {
+                buffer = new HitBuffer;
+                buffer->state = 0;
+                buffer->count = 0;
+                buffer->table = this;
+                buffer->next = buffers;
+                __atomic_store_n(&buffers, buffer, __ATOMIC_RELEASE);
+            }
+            buffer->owned = true;
+
+            pthread_mutex_unlock(&buffers_lock);
+
+            pthread_setspecific(buffer_key, buffer);
+        }
+
+        return buffer;
+    }
+
+    //called when a thread which used the table exits
+    static void drain_buffer(void *arg)
+    {
+        HitBuffer *buffer = (HitBuffer *)arg;
+        ConcurrentSelfAdjustingBiasedHashtable *table = buffer->table;
+
+        table->apply(buffer, true);
+
+        pthread_mutex_lock(&table->buffers_lock);
+        buffer->owned = false;
+        pthread_mutex_unlock(&table->buffers_lock);
+    }
+
+    //announce the current epoch before reading any node
+    void enter(HitBuffer *buffer)
+    {
+        uint64_t e = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&buffer->state, (e << 1) | 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    }
+
+    void exit(HitBuffer *buffer)
+    {
+        __atomic_store_n(&buffer->state, buffer->state & ~(uint64_t)1, __ATOMIC_RELEASE);
+    }
+
+    //queue an unlinked node to be freed, with the stripe locked.  The list
+    //for this epoch last held nodes from at least three epochs ago, which
+    //are safe to free now.
+    void retire(Stripe &stripe, Node *n)
+    {
+        uint64_t e = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+        int i = e % 3;
+        if (stripe.retired_epoch[i] != e) {
+            for (size_t j = 0; j < stripe.retired[i].size(); ++j) stripe.pool.deallocate(stripe.retired[i][j]);
+            stripe.retired[i].clear();
+            stripe.retired_epoch[i] = e;
+        }
+        stripe.retired[i].push_back(n);
+
+        if (++stripe.retires % ADVANCE_INTERVAL == 0) advance(e);
+    }
+
+    //move to the next epoch if every thread in a find has seen e
+    void advance(uint64_t e)
+    {
+        for (HitBuffer *b = __atomic_load_n(&buffers, __ATOMIC_ACQUIRE); b; b = b->next) {
+            uint64_t state = __atomic_load_n(&b->state, __ATOMIC_SEQ_CST);
+            if ((state & 1) && (state >> 1) != e) return;
+        }
+
+        __atomic_compare_exchange_n(&epoch, &e, e + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    }
+
+    //writers which move nodes between or within chains of a stripe make
+    //its version odd for the duration
+    void begin_move(Stripe &stripe)
+    {
+        __atomic_store_n(&stripe.version, stripe.version + 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_RELEASE);
+    }
+
+    void end_move(Stripe &stripe)
+    {
+        __atomic_store_n(&stripe.version, stripe.version + 1, __ATOMIC_RELEASE);
+    }
+
+    //move logged nodes to the front of their chains, if wait is false hits
+    //in stripes locked by other threads are kept for the next batch
+    void apply(HitBuffer *buffer, bool wait)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < buffer->count; ++i) {
+            Hit &hit = buffer->hits[i];
+            Stripe &stripe = stripes[hit.hash_value % stripe_count];
+
+            if (wait) {
+                pthread_rwlock_wrlock(&stripe.lock);
+            } else if (pthread_rwlock_trywrlock(&stripe.lock)) {
+                buffer->hits[kept++] = hit;
+                continue;
+            }
+
+            //the node may have moved or been removed since it was logged
+            Node **head = &buckets[hit.hash_value % size];
+            Node **p = head;
+            while (*p && (*p)->stamp != hit.stamp) p = &(*p)->next;
+
+            //a find walking past the node's old place would miss it
+            if (*p && p != head) {
+                Node *n = *p;
+                begin_move(stripe);
+                __atomic_store_n(p, n->next, __ATOMIC_RELEASE);
+                __atomic_store_n(&n->next, *head, __ATOMIC_RELEASE);
+                __atomic_store_n(head, n, __ATOMIC_RELEASE);
+                end_move(stripe);
+            }
+
+            pthread_rwlock_unlock(&stripe.lock);
+        }
+
+        buffer->count = kept;
+    }
+
+    void grow()
+    {
+        for (size_t i = 0; i < stripe_count; ++i) pthread_rwlock_wrlock(&stripes[i].lock);
+
+        //another thread may have grown the table while we waited
+        if ((float)__atomic_load_n(&count, __ATOMIC_RELAXED) > max_load * (float)size) {
+            for (size_t i = 0; i < stripe_count; ++i) begin_move(stripes[i]);
+
+            size_t new_size = size * 2;
+            Node **new_buckets = new Node *[new_size];
+            for (size_t i = 0; i < new_size; ++i) new_buckets[i] = 0;
+
+            //append to the new chains so they keep their order.  Every link
+            //points forward in the order nodes are appended, so a find
+            //walking through a half moved chain still comes to an end.
+            for (size_t i = 0; i < size; ++i) {
+                Node *n = buckets[i];
+                while (n) {
+                    Node *next = n->next;
+
+                    Node **p = &new_buckets[n->hash_value % new_size];
+                    while (*p) p = &(*p)->next;
+                    __atomic_store_n(&n->next, (Node *)0, __ATOMIC_RELEASE);
+                    __atomic_store_n(p, n, __ATOMIC_RELEASE);
+
+                    n = next;
+                }
+            }
+
+            old_buckets.push_back(buckets);
+            __atomic_store_n(&buckets, new_buckets, __ATOMIC_RELEASE);
+            __atomic_store_n(&size, new_size, __ATOMIC_RELEASE);
+
+            for (size_t i = 0; i < stripe_count; ++i) end_move(stripes[i]);
+        }
+
+        for (size_t i = stripe_count; i > 0; --i) pthread_rwlock_unlock(&stripes[i - 1].lock);
+    }
+};
+
+#endif
@@ -0,0 +1,406 @@
+/*
+Copyright (c) 2010 Daniel Minor
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef CONCURRENT_BIASED_SKIPLIST_H_
+#define CONCURRENT_BIASED_SKIPLIST_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <pthread.h>
+
+#include "random.h"
+
+/*
+Lock-free version of BiasedSkiplist.
+
+Based upon the description in:
+Fraser, K. (2004) Practical Lock-Freedom.  PhD thesis, University of
+Cambridge, Technical Report 579.
+
+and the lock-free skip list in:
+Herlihy, M., Shavit, N. (2008) The Art of Multiprocessor Programming,
+Morgan Kaufmann, chapter 14.
+
+Towers are linked with compare and swap.  A node is removed by setting the
+low bit of each of its next pointers from the top down; whoever marks level
+0 has removed the key, and any search which then passes the node unlinks
+it.  Levels are drawn from the weights as in BiasedSkiplist.
+
+Unlinked nodes are freed by epoch based reclamation.  Every operation runs
+inside an epoch announced by its thread, and a node retired in epoch e is
+only freed once the global epoch has reached e + 2, which cannot happen
+while any thread is still in an epoch that could have seen the node.
+
+find copies the value out, as the node may be removed as soon as the search
+ends.  Each thread has its own record holding its epoch, its retired nodes
+and its random number generator, so lookups write nothing shared.
+*/
+
+template<class K, class V, class Random = XorShiftRandom> class ConcurrentBiasedSkiplist {
+
+public:
+
+    ConcurrentBiasedSkiplist(size_t max_level, uint64_t seed = DEFAULT_RANDOM_SEED) : level(1), max_level(max_level), seed(seed), epoch(0), records(0), record_count(0)
+    {
+        head = new_node(max_level);
+
+        pthread_key_create(&record_key, 0);
+        pthread_mutex_init(&records_lock, 0);
+    }
+
+    //no other thread may be using the skip list
+    virtual ~ConcurrentBiasedSkiplist()
+    {
+        Node *n = head;
+        while (n) {
+            Node *t = unmarked(n->next[0]);
+            delete_node(n);
+            n = t;
+        }
+
+        //every record ever handed out is on the list
+        while (records) {
+            Record *t = records;
+            records = records->next;
+            for (int i = 0; i < 3; ++i) free_nodes(t->retired[i]);
+            delete t;
+        }
+
+        pthread_key_delete(record_key);
+        pthread_mutex_destroy(&records_lock);
+    }
+
+    void insert(const K &key, const V &value, size_t weight)
+    {
+        Record *record = enter();
+
+        size_t insert_level = weight_level(weight) + random_heads(record->random.next());
+        if (insert_level > max_level) insert_level = max_level;
+
+        size_t l = __atomic_load_n(&level, __ATOMIC_RELAXED);
+        while (l < insert_level && !__atomic_compare_exchange_n(&level, &l, insert_level, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+        Node **preds = (Node **)alloca(max_level * sizeof(Node *));
+        Node **succs = (Node **)alloca(max_level * sizeof(Node *));
+
+        Node *n = 0;
+        while (true) {
+
+            //we don't handle duplicate keys
+            if (search(key, preds, succs)) {
+                if (n) delete_node(n);
+                exit(record);
+                return;
+            }
+
+            if (!n) {
+                n = new_node(insert_level);
+                n->key = key;
+                n->value = value;
+            }
+
+            for (size_t i = 0; i < insert_level; ++i) n->next[i] = succs[i];
+
+            //linking level 0 adds the key, n was never seen if this fails
+            Node *expected = succs[0];
+            if (__atomic_compare_exchange_n(&preds[0]->next[0], &expected, n, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) break;
+        }
+
+        //link the upper levels, giving up if n is removed meanwhile
+        for (size_t i = 1; i < insert_level; ++i) {
+            while (true) {
+                Node *next = __atomic_load_n(&n->next[i], __ATOMIC_ACQUIRE);
+                if (marked(next)) break;
+                if (next != succs[i] && !__atomic_compare_exchange_n(&n->next[i], &next, succs[i], false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) break;
+
+                Node *expected = succs[i];
+                if (__atomic_compare_exchange_n(&preds[i]->next[i], &expected, n, false, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) break;
+
+                search(key, preds, succs);
+                if (succs[0] != n) break;
+            }
+
+            //a remove which marked n before it was linked here will not
+            //have unlinked it at this level, so search again to do so
+            if (marked(__atomic_load_n(&n->next[i], __ATOMIC_ACQUIRE))) {
+                search(key, preds, succs);
+                break;
+            }
+        }
+
+        exit(record);
+    }
+
+    //Q can be any type ordered against and equality comparable with K
+    template<class Q> bool find(const Q &key, V &value)
+    {
+        Record *record = enter();
+        bool found = false;
+
+        //marked nodes are stepped over rather than unlinked, so lookups
+        //only read shared memory
+        Node *pred = head;
+        size_t top = __atomic_load_n(&level, __ATOMIC_RELAXED);
+        for (size_t i = top - 1; i >= 0 && i < top; --i) {
+            Node *curr = unmarked(__atomic_load_n(&pred->next[i], __ATOMIC_ACQUIRE));
+            while (curr) {
+                Node *succ = __atomic_load_n(&curr->next[i], __ATOMIC_ACQUIRE);
+                if (marked(succ)) {
+                    curr = unmarked(succ);
+                } else if (curr->key < key) {
+                    pred = curr;
+                    curr = succ;
+                } else {
+                    break;
+                }
+            }
+
+            if (curr && curr->key == key && !marked(__atomic_load_n(&curr->next[0], __ATOMIC_ACQUIRE))) {
+                value = curr->value;
+                found = true;
+                break;
+            }
+        }
+
+        exit(record);
+        return found;
+    }
+
+    template<class Q> void remove(const Q &key)
+    {
+        Record *record = enter();
+
+        Node **preds = (Node **)alloca(max_level * sizeof(Node *));
+        Node **succs = (Node **)alloca(max_level * sizeof(Node *));
+
+        if (search(key, preds, succs)) {
+            Node *n = succs[0];
+
+            //mark the upper levels from the top down
+            for (size_t i = n->level - 1; i >= 1 && i < n->level; --i) {
+                Node *next = __atomic_load_n(&n->next[i], __ATOMIC_ACQUIRE);
+                while (!marked(next) && !__atomic_compare_exchange_n(&n->next[i], &next, mark(next), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+            }
+
+            //marking level 0 decides which remove wins
+            Node *next = __atomic_load_n(&n->next[0], __ATOMIC_ACQUIRE);
+            while (!marked(next)) {
+                if (__atomic_compare_exchange_n(&n->next[0], &next, mark(next), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                    search(key, preds, succs);
+                    retire(record, n);
+                    break;
+                }
+            }
+        }
+
+        exit(record);
+    }
+
+private:
+
+    //next points at the tower, which is stored inline straight after the
+    //node.  A set low bit in next[i] marks the node as removed at level i.
+    struct Node {
+        K key;
+        V value;
+        size_t level;
+        Node **next;
+
+        Node(size_t level) : key(), value(), level(level)
+        {
+            next = (Node **)(this + 1);
+            for (size_t i = 0; i < level; ++i) next[i] = 0;
+        }
+    };
+
+    //per thread state, padded so records of different threads do not
+    //share a cache line
+    struct Record {
+        char padding[64];
+
+        //epoch << 1, with the low bit set while in an operation
+        uint64_t state;
+
+        Random random;
+        size_t retires;
+
+        //nodes retired in the epochs tagged, by epoch modulo 3
+        std::vector<Node *> retired[3];
+        uint64_t retired_epoch[3];
+
+        Record *next;
+
+        Record(uint64_t seed) : state(0), random(seed), retires(0), next(0)
+        {
+            for (int i = 0; i < 3; ++i) retired_epoch[i] = 0;
+        }
+    };
+
+    //try to advance the epoch after this many retires by one thread
+    static const size_t ADVANCE_INTERVAL = 64;
+
+    Node *head;
+    size_t level;
+    size_t max_level;
+    uint64_t seed;
+
+    uint64_t epoch;
+    Record *records;
+    size_t record_count;
+    pthread_key_t record_key;
+    pthread_mutex_t records_lock;
+
+    static bool marked(Node *n)
+    {
+        return ((uintptr_t)n & 1) != 0;
+    }
+
+    static Node *mark(Node *n)
+    {
+        return (Node *)((uintptr_t)n | 1);
+    }
+
+    static Node *unmarked(Node *n)
+    {
+        return (Node *)((uintptr_t)n & ~(uintptr_t)1);
+    }
+
+    Node *new_node(size_t level)
+    {
+        void *p = malloc(sizeof(Node) + level*sizeof(Node *));
+        if (!p) throw std::bad_alloc();
+        return new (p) Node(level);
+    }
+
+    void delete_node(Node *n)
+    {
+        n->~Node();
+        free(n);
+    }
+
+    void free_nodes(std::vector<Node *> &nodes)
+    {
+        for (size_t i = 0; i < nodes.size(); ++i) delete_node(nodes[i]);
+        nodes.clear();
+    }
+
+    /*
+    Find the predecessor and successor of key at every level in use,
+    unlinking marked nodes on the way.  If an unlink fails another thread
+    changed the predecessor and the search starts over.  Returns true if
+    succs[0] holds key.
+
+    The level only grows, and it is raised before a node is linked, so it
+    covers every level of any node the caller has seen or is inserting.
+    Entries of preds and succs above it are left unset.
+    */
+    template<class Q> bool search(const Q &key, Node **preds, Node **succs)
+    {
+    retry:
+        Node *pred = head;
+        size_t top = __atomic_load_n(&level, __ATOMIC_ACQUIRE);
+        for (size_t i = top - 1; i >= 0 && i < top; --i) {
+            Node *curr = unmarked(__atomic_load_n(&pred->next[i], __ATOMIC_ACQUIRE));
+            while (curr) {
+                Node *succ = __atomic_load_n(&curr->next[i], __ATOMIC_ACQUIRE);
+                if (marked(succ)) {
+                    Node *expected = curr;
+                    if (!__atomic_compare_exchange_n(&pred->next[i], &expected, unmarked(succ), false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) goto retry;
+                    curr = unmarked(succ);
+                } else if (curr->key < key) {
+                    pred = curr;
+                    curr = succ;
+                } else {
+                    break;
+                }
+            }
+
+            preds[i] = pred;
+            succs[i] = curr;
+        }
+
+        return succs[0] && succs[0]->key == key;
+    }
+
+    //record for the calling thread, created on first use
+    Record *thread_record()
+    {
+        Record *record = (Record *)pthread_getspecific(record_key);
+        if (!record) {
+            pthread_mutex_lock(&records_lock);
+            record = new Record(seed + 0x9E3779B97F4A7C15ULL*record_count++);
+            record->next = records;
+            __atomic_store_n(&records, record, __ATOMIC_RELEASE);
+            pthread_mutex_unlock(&records_lock);
+
+            pthread_setspecific(record_key, record);
+        }
+
+        return record;
+    }
+
+    //announce the current epoch before touching any node
+    Record *enter()
+    {
+        Record *record = thread_record();
+        uint64_t e = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+        __atomic_store_n(&record->state, (e << 1) | 1, __ATOMIC_SEQ_CST);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        return record;
+    }
+
+    void exit(Record *record)
+    {
+        __atomic_store_n(&record->state, record->state & ~(uint64_t)1, __ATOMIC_RELEASE);
+    }
+
+    //queue an unlinked node to be freed.  The list for this epoch last held
+    //nodes from at least three epochs ago, which are safe to free now.
+    void retire(Record *record, Node *n)
+    {
+        uint64_t e = __atomic_load_n(&epoch, __ATOMIC_ACQUIRE);
+        int i = e % 3;
+        if (record->retired_epoch[i] != e) {
+            free_nodes(record->retired[i]);
+            record->retired_epoch[i] = e;
+        }
+        record->retired[i].push_back(n);
+
+        if (++record->retires % ADVANCE_INTERVAL == 0) advance(e);
+    }
+
+    //move to the next epoch if every thread in an operation has seen e
+    void advance(uint64_t e)
+    {
+        for (Record *r = __atomic_load_n(&records, __ATOMIC_ACQUIRE); r; r = r->next) {
+            uint64_t state = __atomic_load_n(&r->state, __ATOMIC_SEQ_CST);
+            if ((state & 1) && (state >> 1) != e) return;
+        }
+
+        __atomic_compare_exchange_n(&epoch, &e, e + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+    }
+};
+
+#endif
@@ -0,0 +1,398 @@
+/*
+Copyright (c) 2010 Daniel Minor
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef DETERMINISTIC_BIASED_SKIPLIST_H_
+#define DETERMINISTIC_BIASED_SKIPLIST_H_
+
+#include <cstdlib>
+#include <new>
+
+#include "random.h"
+#include "slab_allocator.h"
+
+/*
+Deterministic skip list for weighted / biased searches.
+
+Based upon the (a, b)-biased skip lists in:
+Bagchi, A., Buchsbaum, A., Goodrich, M. T., (2005) Biased Skip Lists.
+Algorithmica, Vol 42, Number 1, pp. 31--48.
+
+A key of weight w has rank r = 1 + log2(w), and its tower is never lower
+than r.  Call the nodes whose towers end at level i, between two
+consecutive nodes which reach above it, a gap at level i.  Two rules
+replace the coin flips of BiasedSkiplist:
+
+ - no gap holds more than MAX_GAP nodes.  A gap which grows past that has
+   its middle node promoted one level.
+ - a node which reaches level j only by promotion, with j >= r, has at
+   least MIN_GAP nodes in the gap just before it at level j - 1.  A node
+   for which that fails is demoted to level j - 1.
+
+The head is raised whenever a promotion reaches it, so it stays above
+every tower and the rules hold on every level, the top one included.
+max_level only caps the rank a weight can ask for.
+
+The first rule means a search makes at most MAX_GAP + 1 steps per level.
+Each promoted node at level j stands for MIN_GAP nodes which stop just
+below it, so at most 2W/2^j nodes of total weight W reach level j, and a
+key of weight w is found in O(log(W/w)) steps in the worst case rather
+than in expectation.  Updates repair the rules with promotions and
+demotions which spread out from the changed node.
+
+Towers change height in place, so they are kept apart from the nodes in
+blocks which are reallocated when they grow or shrink, and are linked in
+both directions so a node can be promoted or demoted without a search.
+*/
+
+template<class K, class V> class DeterministicBiasedSkiplist {
+
+public:
+
+    DeterministicBiasedSkiplist(size_t max_level) : level(1), max_level(max_level)
+    {
+        head = new_node(max_level);
+    }
+
+    virtual ~DeterministicBiasedSkiplist()
+    {
+        Node *n = head;
+        while (n != 0) {
+            Node *t = n->links[0].next;
+            delete_node(n);
+            n = t;
+        }
+    }
+
+    void insert(const K &key, const V &value, size_t weight)
+    {
+        size_t rank = weight_level(weight);
+        if (rank > max_level - 1) rank = max_level - 1;
+        if (rank > level) level = rank;
+
+        //search through skip list from the top, keeping the predecessor at
+        //each level the new node will be linked into
+        Node **update = (Node **)alloca(rank * sizeof(Node *));
+
+        Node *t = head;
+        for (size_t i = level - 1; i >= 0 && i < level; --i) {
+            while (t->links[i].next != 0 && t->links[i].next->key < key) t = t->links[i].next;
+            if (i < rank) update[i] = t;
+        }
+
+        //we don't handle duplicate keys
+        if (t->links[0].next && t->links[0].next->key == key) {
+            return;
+        }
+
+        Node *n = new_node(rank);
+        n->key = key;
+        n->value = value;
+        n->rank = (unsigned int)rank;
+
+        for (size_t i = 0; i < rank; ++i) link(n, update[i], i);
+
+        //n joins a gap at its top level and splits the gaps below it
+        fix_gap(rank - 1, n);
+        for (size_t i = 0; i + 1 < rank; ++i) justify(gap_end(n, i), i + 1);
+    }
+
+    //Q can be any type ordered against and equality comparable with K
+    template<class Q> V *find(const Q &key)
+    {
+        Node *n = search(key);
+        return n ? &n->value : 0;
+    }
+
+    template<class Q> void remove(const Q &key)
+    {
+        Node *n = search(key);
+        if (!n) return;
+
+        //the node after the gap n ends in at its top level
+        size_t height = n->height;
+        Node *after = gap_end(n, height - 1);
+
+        Node **prev = (Node **)alloca(height * sizeof(Node *));
+        for (size_t i = 0; i < height; ++i) {
+            prev[i] = n->links[i].prev;
+            unlink(n, i);
+        }
+
+        delete_node(n);
+
+        //the gaps n separated merge, and the one it was in is one shorter
+        for (size_t i = 0; i + 1 < height; ++i) fix_gap(i, prev[i]);
+        justify(after, height);
+    }
+
+    //give key a new weight, by removing it and inserting it again
+    template<class Q> void reweight(const Q &key, size_t weight)
+    {
+        Node *n = search(key);
+        if (!n) return;
+
+        K k = n->key;
+        V v = n->value;
+        remove(key);
+        insert(k, v, weight);
+    }
+
+    static const size_t MIN_GAP = 2;
+    static const size_t MAX_GAP = 2*MIN_GAP;
+
+    //number of broken links, keys out of order and nodes breaking either
+    //rule, 0 if the list is sound.  Takes linear time, for testing.
+    size_t check() const
+    {
+        size_t broken = 0;
+
+        for (size_t i = 0; i < head->height; ++i) {
+            size_t length = 0;
+            for (Node *p = head; p->links[i].next; p = p->links[i].next) {
+                Node *n = p->links[i].next;
+                if (n->links[i].prev != p || n->height <= i) ++broken;
+                if (p != head && !(p->key < n->key)) ++broken;
+
+                if (n->height != i + 1) length = 0;
+                else if (++length > MAX_GAP) ++broken;
+            }
+        }
+
+        for (Node *n = head->links[0].next; n; n = n->links[0].next) {
+            if (n->height < n->rank || n->height > level) ++broken;
+
+            for (size_t j = n->rank; j < n->height; ++j) {
+                size_t length = 0;
+                for (Node *p = n->links[j - 1].prev; p->height == j; p = p->links[j - 1].prev) ++length;
+                if (length < MIN_GAP) ++broken;
+            }
+        }
+
+        return broken;
+    }
+
+    //number of nodes a search for key is compared against, at most
+    //MAX_GAP + 1 on each level it passes through.  For testing.
+    template<class Q> size_t steps(const Q &key) const
+    {
+        size_t count = 0;
+
+        Node *t = head;
+        for (size_t i = level - 1; i >= 0 && i < level; --i) {
+            while (t->links[i].next != 0) {
+                ++count;
+                if (!(t->links[i].next->key < key)) break;
+                t = t->links[i].next;
+            }
+            if (t->links[i].next && t->links[i].next->key == key) break;
+        }
+
+        return count;
+    }
+
+private:
+
+    struct Node;
+
+    struct Link {
+        Node *next;
+        Node *prev;
+    };
+
+    //rank is the height the weight asks for, height the current one
+    struct Node {
+        K key;
+        V value;
+        unsigned int rank;
+        unsigned int height;
+        Link *links;
+
+        Node() : key(), value(), rank(1), height(0), links(0)
+        {
+        }
+    };
+
+    Node *head;
+    size_t level;
+    size_t max_level;
+
+    ChunkAllocator arena;
+
+    Node *new_node(size_t height)
+    {
+        Node *n = new (arena.allocate(sizeof(Node))) Node();
+        resize(n, height);
+        return n;
+    }
+
+    void delete_node(Node *n)
+    {
+        resize(n, 0);
+        n->~Node();
+        arena.deallocate(n, sizeof(Node));
+    }
+
+    //move the tower of n to a block for height levels, keeping the links
+    //of the levels both have.  New levels start unlinked.
+    void resize(Node *n, size_t height)
+    {
+        Link *links = 0;
+        if (height) {
+            links = (Link *)arena.allocate(height * sizeof(Link));
+            for (size_t i = 0; i < height; ++i) {
+                if (i < n->height) {
+                    links[i] = n->links[i];
+                } else {
+                    links[i].next = links[i].prev = 0;
+                }
+            }
+        }
+
+        if (n->height) arena.deallocate(n->links, n->height * sizeof(Link));
+
+        n->links = links;
+        n->height = (unsigned int)height;
+    }
+
+    template<class Q> Node *search(const Q &key)
+    {
+        Node *t = head;
+        for (size_t i = level - 1; i >= 0 && i < level; --i) {
+            while (t->links[i].next != 0 && t->links[i].next->key < key) t = t->links[i].next;
+            if (t->links[i].next && t->links[i].next->key == key) return t->links[i].next;
+        }
+
+        return 0;
+    }
+
+    //link n after p at level i
+    void link(Node *n, Node *p, size_t i)
+    {
+        n->links[i].prev = p;
+        n->links[i].next = p->links[i].next;
+        if (n->links[i].next) n->links[i].next->links[i].prev = n;
+        p->links[i].next = n;
+    }
+
+    void unlink(Node *n, size_t i)
+    {
+        n->links[i].prev->links[i].next = n->links[i].next;
+        if (n->links[i].next) n->links[i].next->links[i].prev = n->links[i].prev;
+    }
+
+    //the first node of the gap at level i which p is in, or which follows
+    //p if p reaches above level i.  The head reaches above every gap.
+    Node *gap_start(Node *p, size_t i)
+    {
+        if (p->height > i + 1) return p->links[i].next;
+
+        while (p->links[i].prev->height == i + 1) p = p->links[i].prev;
+        return p;
+    }
+
+    //the node reaching above level i which ends the gap after p or with p
+    //in it, 0 at the end of the list
+    Node *gap_end(Node *p, size_t i)
+    {
+        Node *n = p->links[i].next;
+        while (n && n->height == i + 1) n = n->links[i].next;
+        return n;
+    }
+
+    //split the gap at level i which p is in or precedes by promoting its
+    //middle node, until no gap left there or above is too long.  Both
+    //halves keep at least MIN_GAP nodes, so no demotions follow.
+    void fix_gap(size_t i, Node *p)
+    {
+        Node *first = gap_start(p, i);
+
+        size_t length = 0;
+        for (Node *n = first; n && n->height == i + 1; n = n->links[i].next) ++length;
+        if (length <= MAX_GAP) return;
+
+        Node *m = first;
+        for (size_t k = 0; k < length / 2; ++k) m = m->links[i].next;
+
+        promote(m);
+
+        fix_gap(i, first);
+        fix_gap(i, m);
+        fix_gap(i + 1, m);
+    }
+
+    //raise the tower of n by one level, linking it after the last node
+    //before it which reaches that level.  The head is raised too if it
+    //would no longer reach above n, so the new top level is a gap.
+    void promote(Node *n)
+    {
+        size_t height = n->height;
+        if (height + 2 > head->height) resize(head, height + 2);
+
+        Node *p = n->links[height - 1].prev;
+        while (p->height <= height) p = p->links[height - 1].prev;
+
+        resize(n, height + 1);
+        link(n, p, height);
+
+        if (height + 1 > level) level = height + 1;
+    }
+
+    //check the second rule for n at level j, now that the gap before it at
+    //level j - 1 may be shorter
+    void justify(Node *n, size_t j)
+    {
+        if (!n || n->rank > j) return;
+
+        size_t length = 0;
+        Node *p = n->links[j - 1].prev;
+        while (length < MIN_GAP && p->height == j) {
+            ++length;
+            p = p->links[j - 1].prev;
+        }
+
+        if (length < MIN_GAP) demote(n, j);
+    }
+
+    //lower the tower of n to height levels.  n joins the gap at the new top
+    //level, the gaps it separated above merge, and the gap it was in at the
+    //old top level is one shorter.  Demotions only follow from the last of
+    //these, so the nodes kept for the others stay where they are.
+    void demote(Node *n, size_t height)
+    {
+        size_t old_height = n->height;
+        Node *after = gap_end(n, old_height - 1);
+
+        Node **prev = (Node **)alloca((old_height - height) * sizeof(Node *));
+        for (size_t i = height; i < old_height; ++i) {
+            prev[i - height] = n->links[i].prev;
+            unlink(n, i);
+        }
+
+        resize(n, height);
+
+        fix_gap(height - 1, n);
+        for (size_t i = height; i + 1 < old_height; ++i) fix_gap(i, prev[i - height]);
+        justify(after, old_height);
+    }
+};
+
+#endif
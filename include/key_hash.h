@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2010 Daniel Minor
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef KEY_HASH_H_
+#define KEY_HASH_H_
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+/*
+Default hash functor for the hashtables.
+
+Keys convertible to a string view are hashed with Austin Appleby's
+MurmurHash2 over their bytes, so a std::string and a view or C string of
+the same characters hash alike and lookups need not build a string.
+Integer keys are mixed by value, so an int and a long holding the same
+value hash alike too.  Other key types need a hash passed explicitly.
+*/
+
+const unsigned int KEY_HASH_SEED = 0x5432FEDC;
+
+//MurmurHash2, by Austin Appleby, placed in the public domain
+inline unsigned int murmur_hash2(const void *key, size_t len, unsigned int seed)
+{
+    const unsigned int m = 0x5bd1e995;
+    const int r = 24;
+
+    unsigned int h = seed ^ (unsigned int)len;
+
+    const unsigned char *data = (const unsigned char *)key;
+
+    while (len >= 4) {
+        unsigned int k;
+        memcpy(&k, data, sizeof(k));
+
+        k *= m;
+        k ^= k >> r;
+        k *= m;
+
+        h *= m;
+        h ^= k;
+
+        data += 4;
+        len -= 4;
+    }
+
+    switch (len) {
+    case 3: h ^= data[2] << 16; //fall through
+    case 2: h ^= data[1] << 8;  //fall through
+    case 1: h ^= data[0];
+            h *= m;
+    };
+
+    h ^= h >> 13;
+    h *= m;
+    h ^= h >> 15;
+
+    return h;
+}
+
+template<class T, class Enable = void> struct KeyHashOf {
+    static_assert(sizeof(T) == 0, "no default hash for this key type, pass one to the hashtable");
+};
+
+template<class T> struct KeyHashOf<T, typename std::enable_if<std::is_convertible<const T &, std::string_view>::value>::type> {
+    static unsigned int get(const T &key)
+    {
+        std::string_view s(key);
+        return murmur_hash2(s.data(), s.size(), KEY_HASH_SEED);
+    }
+};
+
+//the finalizer of MurmurHash3's 64 bit hash
+template<class T> struct KeyHashOf<T, typename std::enable_if<std::is_integral<T>::value>::type> {
+    static unsigned int get(const T &key)
+    {
+        uint64_t h = (uint64_t)key;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return (unsigned int)h;
+    }
+};
+
+struct KeyHash {
+    template<class T> unsigned int operator()(const T &key) const
+    {
+        return KeyHashOf<T>::get(key);
+    }
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+Copyright (c) 2010 Daniel Minor
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef KEY_PREFIX_H_
+#define KEY_PREFIX_H_
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+/*
+Inline key prefixes for the search trees.
+
+Tree nodes keep the first 8 bytes of a string key packed big-endian into an
+integer, zero padded.  Bytes compare as unsigned char, as std::string does,
+so when two prefixes differ they order the keys, and the key itself, which
+usually lives in another heap block, is only read when the prefixes tie.
+Keys which are not strings all get prefix 0 and always use the full compare,
+as does a lookup where only one of the key and query types is a string.
+*/
+
+typedef uint64_t KeyPrefix;
+
+template<class T, class Enable = void> struct KeyPrefixOf {
+    static const bool enabled = false;
+
+    static KeyPrefix get(const T &)
+    {
+        return 0;
+    }
+};
+
+template<class T> struct KeyPrefixOf<T, typename std::enable_if<std::is_convertible<const T &, std::string_view>::value>::type> {
+    static const bool enabled = true;
+
+    static KeyPrefix get(const T &key)
+    {
+        std::string_view s(key);
+
+        KeyPrefix prefix = 0;
+        size_t len = s.size() < sizeof(KeyPrefix) ? s.size() : sizeof(KeyPrefix);
+        for (size_t i = 0; i < len; ++i) {
+            prefix |= (KeyPrefix)(unsigned char)s[i] << (8*(sizeof(KeyPrefix) - 1 - i));
+        }
+
+        return prefix;
+    }
+};
+
+template<class T> KeyPrefix key_prefix(const T &key)
+{
+    return KeyPrefixOf<T>::get(key);
+}
+
+//true if prefixes of keys of type A and B may be compared
+template<class A, class B> struct KeyPrefixesComparable {
+    static const bool value = KeyPrefixOf<A>::enabled && KeyPrefixOf<B>::enabled;
+};
+
+#endif
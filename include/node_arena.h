@@ -0,0 +1,107 @@
+/*
+Copyright (c) 2010 Daniel Minor 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef NODE_ARENA_H_
+#define NODE_ARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+/*
+Index addressed node store for the treaps.
+
+Nodes live in fixed size chunks which are never moved or reallocated, so
+references to nodes, and the value pointers handed out by find, stay valid
+while the arena grows.  Node i is slot i & CHUNK_MASK of chunk
+i >> CHUNK_SHIFT, which keeps the links between nodes 32 bit indices, and
+clearing the arena frees it a chunk at a time.
+*/
+
+template<class Node, class Index = unsigned int> class NodeArena {
+
+public:
+
+    NodeArena() : count(0)
+    {
+    }
+
+    NodeArena(const NodeArena &other) : count(0)
+    {
+        for (size_t i = 0; i < other.count; ++i) push_back(other[(Index)i]);
+    }
+
+    NodeArena &operator=(const NodeArena &other)
+    {
+        if (&other != this) {
+            clear();
+            for (size_t i = 0; i < other.count; ++i) push_back(other[(Index)i]);
+        }
+
+        return *this;
+    }
+
+    ~NodeArena()
+    {
+        clear();
+    }
+
+    Node &operator[](Index i)
+    {
+        return chunks[i >> CHUNK_SHIFT][i & CHUNK_MASK];
+    }
+
+    const Node &operator[](Index i) const
+    {
+        return chunks[i >> CHUNK_SHIFT][i & CHUNK_MASK];
+    }
+
+    //number of nodes ever added, in use or not
+    size_t size() const
+    {
+        return count;
+    }
+
+    void push_back(const Node &node)
+    {
+        if ((count & CHUNK_MASK) == 0) chunks.push_back(new Node[CHUNK_SIZE]);
+        chunks.back()[count & CHUNK_MASK] = node;
+        ++count;
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < chunks.size(); ++i) delete[] chunks[i];
+        chunks.clear();
+        count = 0;
+    }
+
+private:
+
+    static const size_t CHUNK_SHIFT = 9;
+    static const size_t CHUNK_SIZE = (size_t)1 << CHUNK_SHIFT;
+    static const size_t CHUNK_MASK = CHUNK_SIZE - 1;
+
+    std::vector<Node *> chunks;
+    size_t count;
+};
+
+#endif
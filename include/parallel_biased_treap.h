@@ -0,0 +1,202 @@
+/*
+Copyright (c) 2010 Daniel Minor 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef PARALLEL_BIASED_TREAP_H_
+#define PARALLEL_BIASED_TREAP_H_
+
+#include <vector>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "biased_treap.h"
+
+/*
+Set operations on BiasedTreap which hand large subtrees to other threads,
+kept apart from biased_treap.h so only programs which use them need to be
+built with -pthread.
+
+A union splits on the root of higher priority and combines the subtrees on
+either side independently, so the first few levels of the recursion each
+start a thread for their left pair.  Removed ranges are freed the same way.
+With max_threads of 0 the number of online processors is used.
+*/
+
+template<class K, class V, class Random> class ParallelBiasedTreap {
+
+public:
+
+    typedef BiasedTreap<K, V, Random> Treap;
+
+    static void union_with(Treap &treap, const Treap &other, size_t max_threads)
+    {
+        if (&other == &treap || !other.root) return;
+
+        unite_root(treap, treap.clone(other, other.root, Treap::NIL), max_threads);
+    }
+
+    static void unite(Treap &treap, Treap &other, size_t max_threads)
+    {
+        if (&other == &treap || !other.root) return;
+
+        unite_root(treap, treap.adopt(other), max_threads);
+    }
+
+    static void erase_range(Treap &treap, const K &lo, const K &hi, size_t max_threads)
+    {
+        Index mid = treap.cut_range(lo, hi);
+
+        std::vector<Index> released;
+        destroy_nodes(treap, mid, fork_depth(treap, max_threads), released);
+        treap.recycle(released);
+    }
+
+private:
+
+    typedef typename Treap::Index Index;
+    typedef typename Treap::Node Node;
+
+    //below this many nodes everything is done on the calling thread
+    static const size_t PARALLEL_THRESHOLD = 16384;
+
+    //how many levels of recursion may hand a subtree to a new thread
+    static int fork_depth(const Treap &treap, size_t max_threads)
+    {
+        if (treap.nodes.size() < PARALLEL_THRESHOLD) return 0;
+        if (max_threads == 0) max_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+        int depth = 0;
+        while (((size_t)2 << depth) <= max_threads) ++depth;
+        return depth;
+    }
+
+    struct Task {
+        Treap *treap;
+        Index a;
+        Index b;
+        Index result;
+        int depth;
+        std::vector<Index> discarded;
+    };
+
+    static void *union_thread(void *arg)
+    {
+        Task *task = (Task *)arg;
+        task->result = union_nodes(*task->treap, task->a, task->b, task->depth, task->discarded);
+        return 0;
+    }
+
+    static void *clear_thread(void *arg)
+    {
+        Task *task = (Task *)arg;
+        destroy_nodes(*task->treap, task->a, task->depth, task->discarded);
+        return 0;
+    }
+
+    static void unite_root(Treap &treap, Index b, size_t max_threads)
+    {
+        std::vector<Index> discarded;
+        treap.root = union_nodes(treap, treap.root, b, fork_depth(treap, max_threads), discarded);
+        treap.nodes[treap.root].parent = Treap::NIL;
+
+        treap.release(discarded);
+    }
+
+    static Index union_nodes(Treap &treap, Index a, Index b, int depth, std::vector<Index> &discarded)
+    {
+        if (depth == 0 || !a || !b) return treap.union_nodes(a, b, discarded);
+
+        Index left_a, left_b, right_a, right_b;
+        Index root = treap.union_split(a, b, left_a, left_b, right_a, right_b, discarded);
+
+        Task task;
+        task.treap = &treap;
+        task.a = left_a;
+        task.b = left_b;
+        task.depth = depth - 1;
+
+        Index left, right;
+        pthread_t thread;
+        if (pthread_create(&thread, 0, union_thread, &task) == 0) {
+            right = union_nodes(treap, right_a, right_b, depth - 1, discarded);
+            pthread_join(thread, 0);
+            left = task.result;
+            discarded.insert(discarded.end(), task.discarded.begin(), task.discarded.end());
+        } else {
+            left = union_nodes(treap, left_a, left_b, depth - 1, discarded);
+            right = union_nodes(treap, right_a, right_b, depth - 1, discarded);
+        }
+
+        treap.set_left(root, left);
+        treap.set_right(root, right);
+        return root;
+    }
+
+    static void destroy_nodes(Treap &treap, Index t, int depth, std::vector<Index> &released)
+    {
+        if (depth == 0 || !t) {
+            treap.destroy_nodes(t, released);
+            return;
+        }
+
+        Index left = treap.nodes[t].left;
+        Index right = treap.nodes[t].right;
+        treap.nodes[t] = Node();
+        released.push_back(t);
+
+        Task task;
+        task.treap = &treap;
+        task.a = left;
+        task.depth = depth - 1;
+
+        pthread_t thread;
+        if (pthread_create(&thread, 0, clear_thread, &task) == 0) {
+            destroy_nodes(treap, right, depth - 1, released);
+            pthread_join(thread, 0);
+            released.insert(released.end(), task.discarded.begin(), task.discarded.end());
+        } else {
+            destroy_nodes(treap, left, depth - 1, released);
+            destroy_nodes(treap, right, depth - 1, released);
+        }
+    }
+};
+
+//add every key of other not already present to treap, other is left
+//unchanged
+template<class K, class V, class Random> void parallel_union_with(BiasedTreap<K, V, Random> &treap, const BiasedTreap<K, V, Random> &other, size_t max_threads = 0)
+{
+    ParallelBiasedTreap<K, V, Random>::union_with(treap, other, max_threads);
+}
+
+//as parallel_union_with, but takes the nodes of other and leaves it empty
+template<class K, class V, class Random> void parallel_unite(BiasedTreap<K, V, Random> &treap, BiasedTreap<K, V, Random> &other, size_t max_threads = 0)
+{
+    ParallelBiasedTreap<K, V, Random>::unite(treap, other, max_threads);
+}
+
+//remove every key in [lo, hi) from treap
+template<class K, class V, class Random> void parallel_erase_range(BiasedTreap<K, V, Random> &treap, const K &lo, const K &hi, size_t max_threads = 0)
+{
+    ParallelBiasedTreap<K, V, Random>::erase_range(treap, lo, hi, max_threads);
+}
+
+#endif
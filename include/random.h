@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2010 Daniel Minor
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+Random number policies for the randomized structures.
+
+Each treap or skip list owns a generator rather than sharing the state of
+rand(), so instances on different threads do not contend and a given seed
+always builds the same structure.  A policy is constructed from a 64 bit
+seed and next() returns 32 uniformly random bits.
+*/
+
+const uint64_t DEFAULT_RANDOM_SEED = 0x853c49e6748fea9bULL;
+
+//Marsaglia's xorshift64*, returning the high half of the product
+class XorShiftRandom {
+
+public:
+
+    XorShiftRandom(uint64_t seed) : state(seed ? seed : DEFAULT_RANDOM_SEED)
+    {
+    }
+
+    uint32_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return (uint32_t)((state * 0x2545F4914F6CDD1DULL) >> 32);
+    }
+
+private:
+
+    uint64_t state;
+};
+
+//O'Neill's PCG32 with the XSH RR output function
+class PcgRandom {
+
+public:
+
+    PcgRandom(uint64_t seed) : state(0)
+    {
+        next();
+        state += seed;
+        next();
+    }
+
+    uint32_t next()
+    {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + 1442695040888963407ULL;
+
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+private:
+
+    uint64_t state;
+};
+
+//log2 of the uniform draw bits / 2^32, in [-32, 0).  The integer part is
+//the leading zero count and the bits below the leading one are used as a
+//linear fraction, which is exact at powers of two, never more than 0.09
+//out and keeps the order of the draws.
+inline float random_log2(uint32_t bits)
+{
+    if (!bits) return -32.0f;
+
+    int zeros = __builtin_clz(bits);
+    uint32_t fraction = (bits << zeros) & 0x7fffffff;
+    return (float)(-zeros - 1) + (float)fraction * (1.0f / 2147483648.0f);
+}
+
+//1 + floor(log2(weight)), counting weight 0 as 1
+inline size_t weight_level(size_t weight)
+{
+    return 64 - __builtin_clzll((unsigned long long)weight | 1);
+}
+
+//number of heads before the first tail in 32 fair coin flips
+inline size_t random_heads(uint32_t bits)
+{
+    if (bits == 0xffffffff) return 32;
+    return __builtin_ctz(~bits);
+}
+
+#endif
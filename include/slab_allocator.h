@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2011 Daniel Minor 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef SLAB_ALLOCATOR_H_
+#define SLAB_ALLOCATOR_H_
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/*
+Node allocation policies.  Structures take the policy as a template
+template parameter and call allocate() / deallocate() in place of new and
+delete for their nodes.  When the structure is destroyed it calls
+release() on each node still in use, but only if NEEDS_RELEASE is set.
+*/
+
+//nodes are carved out of slabs of contiguous storage, removed nodes are kept
+//on a free list for reuse and all slabs are released when the allocator is
+template<class T> class SlabAllocator {
+
+public:
+
+    //the slabs are freed in one go, so nodes need no teardown at all
+    //unless they own something themselves
+    static const bool NEEDS_RELEASE = !std::is_trivially_destructible<T>::value;
+
+    SlabAllocator() : slabs(0), free_list(0), slab_size(0), used(0)
+    {
+    }
+
+    virtual ~SlabAllocator()
+    {
+        while (slabs) {
+            Slab *t = slabs;
+            slabs = slabs->next;
+            delete[] t->items;
+            delete t;
+        }
+    }
+
+    T *allocate()
+    {
+        Item *item;
+        if (free_list) {
+            item = free_list;
+            free_list = free_list->next;
+        } else {
+            if (used == slab_size) new_slab();
+            item = &slabs->items[used++];
+        }
+
+        return new (item->storage) T;
+    }
+
+    void deallocate(T *t)
+    {
+        t->~T();
+
+        Item *item = (Item *)t;
+        item->next = free_list;
+        free_list = item;
+    }
+
+    //destroy a node which is still in use when its owner goes away
+    void release(T *t)
+    {
+        t->~T();
+    }
+
+private:
+
+    union Item {
+        Item *next;
+        alignas(T) char storage[sizeof(T)];
+    };
+
+    struct Slab {
+        Item *items;
+        Slab *next;
+    };
+
+    static const size_t MIN_SLAB_SIZE = 32;
+    static const size_t MAX_SLAB_SIZE = 4096;
+
+    Slab *slabs;
+    Item *free_list;
+    size_t slab_size;
+    size_t used;
+
+    //slabs double in size so small structures stay small
+    void new_slab()
+    {
+        if (slab_size == 0) slab_size = MIN_SLAB_SIZE;
+        else if (slab_size < MAX_SLAB_SIZE) slab_size *= 2;
+
+        Slab *slab = new Slab;
+        slab->items = new Item[slab_size];
+        slab->next = slabs;
+        slabs = slab;
+        used = 0;
+    }
+};
+
+//blocks of varying size carved out of large chunks, for nodes whose size
+//depends on their contents.  Sizes are rounded up to the maximum alignment
+//and a freed block goes on a free list for its size, to be reused by the
+//next block of the same size.  All chunks are released with the allocator.
+class ChunkAllocator {
+
+public:
+
+    ChunkAllocator() : chunks(0), top(0), left(0)
+    {
+    }
+
+    virtual ~ChunkAllocator()
+    {
+        while (chunks) {
+            Chunk *t = chunks;
+            chunks = chunks->next;
+            free(t);
+        }
+    }
+
+    void *allocate(size_t size)
+    {
+        size_t units = (size + UNIT - 1) / UNIT;
+
+        if (units < free_lists.size() && free_lists[units]) {
+            Block *block = free_lists[units];
+            free_lists[units] = block->next;
+            return block;
+        }
+
+        size = units*UNIT;
+        if (size > left) new_chunk(size);
+
+        void *result = top;
+        top += size;
+        left -= size;
+        return result;
+    }
+
+    void deallocate(void *p, size_t size)
+    {
+        size_t units = (size + UNIT - 1) / UNIT;
+        if (units >= free_lists.size()) free_lists.resize(units + 1, 0);
+
+        Block *block = (Block *)p;
+        block->next = free_lists[units];
+        free_lists[units] = block;
+    }
+
+private:
+
+    struct Block {
+        Block *next;
+    };
+
+    //chunk header, padded so the storage after it is aligned
+    union Chunk {
+        Chunk *next;
+        std::max_align_t align;
+    };
+
+    static const size_t UNIT = alignof(std::max_align_t);
+    static const size_t CHUNK_SIZE = 65536;
+
+    Chunk *chunks;
+    char *top;
+    size_t left;
+    std::vector<Block *> free_lists;
+
+    //the rest of the current chunk is abandoned
+    void new_chunk(size_t size)
+    {
+        if (size < CHUNK_SIZE) size = CHUNK_SIZE;
+
+        Chunk *chunk = (Chunk *)malloc(sizeof(Chunk) + size);
+        if (!chunk) throw std::bad_alloc();
+
+        chunk->next = chunks;
+        chunks = chunk;
+        top = (char *)(chunk + 1);
+        left = size;
+    }
+};
+
+//plain new and delete for each node
+template<class T> class HeapAllocator {
+
+public:
+
+    static const bool NEEDS_RELEASE = true;
+
+    T *allocate()
+    {
+        return new T;
+    }
+
+    void deallocate(T *t)
+    {
+        delete t;
+    }
+
+    void release(T *t)
+    {
+        delete t;
+    }
+};
+
+#endif
@@ -26,8 +26,11 @@ THE SOFTWARE.
 #include <cstdlib>
 #include <cmath>
 #include <fstream>
+#include <iterator>
 #include <limits>
 
+#include "key_prefix.h"
+
 /*
 Splay Tree implementation
 
@@ -58,10 +61,12 @@ public:
 		} else {
 
 			//insert in tree based on key
+			KeyPrefix prefix = key_prefix(key);
 			Node *n = root;
 			while (true) {
 
-				if (key < n->key) {
+				int c = compare(key, prefix, n);
+				if (c < 0) {
 					if (n->left) {
 						n = n->left;
 					} else {
@@ -69,7 +74,7 @@ public:
 						n = n->left;
 						break;
 					}
-				} else if (n->key < key) {
+				} else if (c > 0) {
 					if (n->right) {
 						n = n->right;
 					} else {
@@ -87,15 +92,18 @@ public:
 		}
 	}
 
-	V *find(const K &key)
+	//Q can be any type ordered against K, so lookups need not build a K
+	template<class Q> V *find(const Q &key)
 	{
 	    V *result = 0;	
 
+		KeyPrefix prefix = key_prefix(key);
 		Node *n = root;
 		while (n && !result) {
-			if (key < n->key) {
+			int c = compare(key, prefix, n);
+			if (c < 0) {
 				n = n->left;
-			} else if (n->key < key) {
+			} else if (c > 0) {
 				n = n->right;
 			} else {
 				result = &n->value;
@@ -106,13 +114,15 @@ public:
 		return result;
 	}
 
-	void remove(const K &key)
+	template<class Q> void remove(const Q &key)
 	{
+		KeyPrefix prefix = key_prefix(key);
 		Node *n = root;
 		while (n) {
-			if (key < n->key) {
+			int c = compare(key, prefix, n);
+			if (c < 0) {
 				n = n->left;
-			} else if (n->key < key) {
+			} else if (c > 0) {
 				n = n->right;
 			} else {
 
@@ -132,6 +142,7 @@ public:
                     //just one right child
                     Node *t = n->right;
                     n->key = t->key;
+                    n->prefix = t->prefix;
                     n->value = t->value;
                     n->left = t->left;
                     if (n->left) n->left->parent = n;
@@ -142,6 +153,7 @@ public:
                     //just one left child
                     Node *t = n->left;
                     n->key = t->key;
+                    n->prefix = t->prefix;
                     n->value = t->value;
                     n->left = t->left;
                     if (n->left) n->left->parent = n;
@@ -156,6 +168,7 @@ public:
 
                     //copy in fields from t
                     n->key = t->key;
+                    n->prefix = t->prefix;
                     n->value = t->value;
 
                     //splice out t
@@ -182,16 +195,79 @@ public:
 		}
 	}
 
+	//in-order position in the tree, see the definition below
+	class iterator;
+
+	iterator begin()
+	{
+		return iterator(this, root ? leftmost(root) : 0);
+	}
+
+	iterator end()
+	{
+		return iterator(this, 0);
+	}
+
+	//first key not less than key.  Only the node found is splayed, so a
+	//range scan costs one descent and splay and then successor walks.
+	template<class Q> iterator lower_bound(const Q &key)
+	{
+		KeyPrefix prefix = key_prefix(key);
+		Node *result = 0;
+		Node *n = root;
+		while (n) {
+			if (compare(key, prefix, n) <= 0) {
+				result = n;
+				n = n->left;
+			} else {
+				n = n->right;
+			}
+		}
+
+		if (result) splay(result);
+		return iterator(this, result);
+	}
+
+	//first key greater than key, splaying it as lower_bound does
+	template<class Q> iterator upper_bound(const Q &key)
+	{
+		KeyPrefix prefix = key_prefix(key);
+		Node *result = 0;
+		Node *n = root;
+		while (n) {
+			if (compare(key, prefix, n) < 0) {
+				result = n;
+				n = n->left;
+			} else {
+				n = n->right;
+			}
+		}
+
+		if (result) splay(result);
+		return iterator(this, result);
+	}
+
+	//call f(key, value) for every key in [lo, hi) in order, e.g. lo "ab"
+	//and hi "ac" for all keys starting with "ab".  f must not change the
+	//tree.
+	template<class L, class H, class F> void for_each_in_range(const L &lo, const H &hi, F f)
+	{
+		for (iterator i = lower_bound(lo); i != end() && i.key() < hi; ++i) {
+			f(i.key(), i.value());
+		}
+	}
+
 private:
 
 	struct Node {
 		K key;
+		KeyPrefix prefix;
 		V value;
 		Node *parent;
 		Node *left;
 		Node *right;
 
-		Node(const K &key, const V &value, Node *parent) : key(key), value(value), parent(parent)
+		Node(const K &key, const V &value, Node *parent) : key(key), prefix(key_prefix(key)), value(value), parent(parent)
 		{
 			left = right = 0;
 		}
@@ -199,6 +275,56 @@ private:
 
 	Node *root;
 
+	//sign of key against the key of n.  The inline prefixes settle most
+	//compares without reading the node's key.
+	template<class Q> int compare(const Q &key, KeyPrefix prefix, const Node *n) const
+	{
+		if (KeyPrefixesComparable<Q, K>::value && prefix != n->prefix) return prefix < n->prefix ? -1 : 1;
+		if (key < n->key) return -1;
+		if (n->key < key) return 1;
+		return 0;
+	}
+
+	static Node *leftmost(Node *n)
+	{
+		while (n->left) n = n->left;
+		return n;
+	}
+
+	static Node *rightmost(Node *n)
+	{
+		while (n->right) n = n->right;
+		return n;
+	}
+
+	//next node in order, walking down the right subtree or else up to the
+	//first ancestor reached from its left
+	static Node *successor(Node *n)
+	{
+		if (n->right) return leftmost(n->right);
+
+		Node *p = n->parent;
+		while (p && p->right == n) {
+			n = p;
+			p = p->parent;
+		}
+
+		return p;
+	}
+
+	static Node *predecessor(Node *n)
+	{
+		if (n->left) return rightmost(n->left);
+
+		Node *p = n->parent;
+		while (p && p->left == n) {
+			n = p;
+			p = p->parent;
+		}
+
+		return p;
+	}
+
 	void splay(Node *n)
 	{
 		//while n is not the root
@@ -285,6 +411,92 @@ private:
 	}
 };
 
-#endif
+//Bidirectional in-order iterator.  It dereferences to the value, the key
+//is read with key().  Decrementing end() gives the largest key.  Stepping
+//does not splay.  Splaying keeps the order of the nodes, so
+//an iterator survives inserts and finds, but a remove may free or reuse
+//the node it points to.
+template<class K, class V> class SplayTree<K, V>::iterator {
+
+public:
+
+	typedef std::bidirectional_iterator_tag iterator_category;
+	typedef V value_type;
+	typedef std::ptrdiff_t difference_type;
+	typedef V *pointer;
+	typedef V &reference;
+
+	iterator() : tree(0), n(0)
+	{
+	}
+
+	const K &key() const
+	{
+		return n->key;
+	}
+
+	V &value() const
+	{
+		return n->value;
+	}
+
+	V &operator*() const
+	{
+		return n->value;
+	}
+
+	V *operator->() const
+	{
+		return &n->value;
+	}
+
+	iterator &operator++()
+	{
+		n = successor(n);
+		return *this;
+	}
 
+	iterator operator++(int)
+	{
+		iterator t = *this;
+		++*this;
+		return t;
+	}
+
+	iterator &operator--()
+	{
+		if (n) n = predecessor(n);
+		else if (tree->root) n = rightmost(tree->root);
+		return *this;
+	}
+
+	iterator operator--(int)
+	{
+		iterator t = *this;
+		--*this;
+		return t;
+	}
+
+	bool operator==(const iterator &other) const
+	{
+		return n == other.n;
+	}
 
+	bool operator!=(const iterator &other) const
+	{
+		return n != other.n;
+	}
+
+private:
+
+	friend class SplayTree;
+
+	SplayTree *tree;
+	Node *n;
+
+	iterator(SplayTree *tree, Node *n) : tree(tree), n(n)
+	{
+	}
+};
+
+#endif
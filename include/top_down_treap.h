@@ -0,0 +1,277 @@
+/*
+Copyright (c) 2010 Daniel Minor
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#ifndef TOP_DOWN_TREAP_H_
+#define TOP_DOWN_TREAP_H_
+
+
+#include "node_arena.h"
+#include "random.h"
+
+/*
+Treap for weighted / biased searches which is updated top-down.
+
+Holds the same tree as BiasedTreap, but rather than inserting at a leaf and
+rotating up, insert descends until it meets a node of lower priority and
+splits that subtree around the new node.  Remove merges the children of the
+node in its place.  Each update is a single descent which only rewrites
+child links, so nodes need no parent index.
+
+Random is the random number policy, see random.h.
+*/
+
+template<class K, class V, class Random = XorShiftRandom> class TopDownBiasedTreap {
+
+public:
+
+    TopDownBiasedTreap(bool self_adjust, uint64_t seed = DEFAULT_RANDOM_SEED) : root(NIL), free_list(NIL), self_adjust(self_adjust), random(seed)
+    {
+        //slot 0 is the null node
+        nodes.push_back(Node());
+    }
+
+    virtual ~TopDownBiasedTreap()
+    {
+    }
+
+    void insert(const K &key, const V &value, size_t weight)
+    {
+        //allocate first, so the links held during the descent stay valid
+        Index n = new_node();
+        nodes[n].key = key;
+        nodes[n].value = value;
+        nodes[n].priority = random_priority(weight);
+
+        //descend past nodes which stay above the new one
+        Index *link = &root;
+        while (*link && !(nodes[*link].priority < nodes[n].priority)) {
+            Index t = *link;
+            if (key < nodes[t].key) {
+                link = &nodes[t].left;
+            } else if (nodes[t].key < key) {
+                link = &nodes[t].right;
+            } else {
+                //already in treap
+                release(n);
+                return;
+            }
+        }
+
+        //the rest of the path is only read, to see if the key is below
+        if (contains(*link, key)) {
+            release(n);
+            return;
+        }
+
+        split(*link, key, nodes[n].left, nodes[n].right);
+        *link = n;
+    }
+
+    //Q can be any type ordered against K, e.g. a string view for string keys.
+    //The value pointer stays valid until its key is removed, as nodes never
+    //move.
+    template<class Q> V *find(const Q &key)
+    {
+        Index n = root;
+        while (n) {
+            if (key < nodes[n].key) {
+                n = nodes[n].left;
+            } else if (nodes[n].key < key) {
+                n = nodes[n].right;
+            } else {
+
+                //if adapting weights, generate a new priority and lift the
+                //node to where it now belongs
+                if (self_adjust) {
+                    float t = random_log2(random.next());
+                    if (t > nodes[n].priority) lift(key, n, t);
+                }
+
+                return &nodes[n].value;
+            }
+        }
+
+        return 0;
+    }
+
+    template<class Q> void remove(const Q &key)
+    {
+        Index *link = &root;
+        while (*link) {
+            Index n = *link;
+            if (key < nodes[n].key) {
+                link = &nodes[n].left;
+            } else if (nodes[n].key < key) {
+                link = &nodes[n].right;
+            } else {
+                *link = merge(nodes[n].left, nodes[n].right);
+                release(n);
+                break;
+            }
+        }
+    }
+
+private:
+
+    //nodes refer to each other by 32 bit index into the arena rather than by
+    //pointer, index 0 is the null node
+    typedef unsigned int Index;
+    static const Index NIL = 0;
+
+    struct Node {
+        K key;
+        V value;
+        float priority;
+        Index left;
+        Index right;
+
+        Node() : key(), value(), priority(0), left(NIL), right(NIL)
+        {
+        }
+    };
+
+    //all nodes live in one arena which is freed in one go with the treap,
+    //removed nodes are chained through their left index for reuse
+    NodeArena<Node, Index> nodes;
+    Index root;
+    Index free_list;
+    bool self_adjust;
+
+    Random random;
+
+    Index new_node()
+    {
+        Index n;
+        if (free_list) {
+            n = free_list;
+            free_list = nodes[n].left;
+        } else {
+            n = (Index)nodes.size();
+            nodes.push_back(Node());
+        }
+
+        nodes[n].left = nodes[n].right = NIL;
+        return n;
+    }
+
+    void release(Index n)
+    {
+        nodes[n].key = K();
+        nodes[n].value = V();
+        nodes[n].right = NIL;
+        nodes[n].left = free_list;
+        free_list = n;
+    }
+
+    //the largest of weight uniform random numbers, so heavier keys tend to
+    //sit nearer the root.  Kept as an approximate log2 of the priority, as
+    //in BiasedTreap.
+    float random_priority(size_t weight)
+    {
+        if (weight == 0) weight = 1;
+        return random_log2(random.next()) / (float)weight;
+    }
+
+    template<class Q> bool contains(Index n, const Q &key)
+    {
+        while (n) {
+            if (key < nodes[n].key) n = nodes[n].left;
+            else if (nodes[n].key < key) n = nodes[n].right;
+            else return true;
+        }
+
+        return false;
+    }
+
+    //split subtree t, which does not hold key, into keys less than key (l)
+    //and greater than key (r).  Both halves are built top-down by following
+    //the link that the next node of each side hangs from.
+    template<class Q> void split(Index t, const Q &key, Index &l, Index &r)
+    {
+        Index *ll = &l;
+        Index *rl = &r;
+        while (t) {
+            if (nodes[t].key < key) {
+                *ll = t;
+                ll = &nodes[t].right;
+                t = nodes[t].right;
+            } else {
+                *rl = t;
+                rl = &nodes[t].left;
+                t = nodes[t].left;
+            }
+        }
+
+        *ll = *rl = NIL;
+    }
+
+    //join subtrees where every key in a is less than every key in b, again
+    //top-down along the right spine of a and the left spine of b
+    Index merge(Index a, Index b)
+    {
+        Index result = NIL;
+        Index *link = &result;
+        while (a && b) {
+            if (nodes[a].priority > nodes[b].priority) {
+                *link = a;
+                link = &nodes[a].right;
+                a = nodes[a].right;
+            } else {
+                *link = b;
+                link = &nodes[b].left;
+                b = nodes[b].left;
+            }
+        }
+
+        *link = a ? a : b;
+        return result;
+    }
+
+    //give node n, holding key, the higher priority p.  The descent stops at
+    //the first node of lower priority, which heads the subtree containing
+    //n, and that subtree is split around n with n put at its head.
+    template<class Q> void lift(const Q &key, Index n, float p)
+    {
+        Index *link = &root;
+        while (!(nodes[*link].priority < p)) {
+            if (key < nodes[*link].key) link = &nodes[*link].left;
+            else link = &nodes[*link].right;
+        }
+
+        nodes[n].priority = p;
+        if (*link == n) return;
+
+        //unhook n, then split what is left of the subtree around it
+        Index *parent = link;
+        while (*parent != n) {
+            if (key < nodes[*parent].key) parent = &nodes[*parent].left;
+            else parent = &nodes[*parent].right;
+        }
+        *parent = merge(nodes[n].left, nodes[n].right);
+
+        Index t = *link;
+        split(t, key, nodes[n].left, nodes[n].right);
+        *link = n;
+    }
+};
+
+#endif
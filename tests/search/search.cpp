@@ -20,15 +20,26 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iostream>
 #include <map>
 #include <string>
+#include <string_view>
+#include <vector>
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
 
 #include "biased_hashtable.h"
+#include "concurrent_biased_hashtable.h"
 #include "biased_skiplist.h"
+#include "concurrent_biased_skiplist.h"
+#include "deterministic_biased_skiplist.h"
 #include "biased_treap.h"
+#include "top_down_treap.h"
 #include "splaytree.h"
 
 const unsigned int MURMURHASH2_SEED = 0x5432FEDC;
@@ -40,9 +51,123 @@ bool operator<(const std::string &a, const std::string &b)
     return a.compare(b) < 0;
 }
 
-unsigned int hash(const std::string &key)
+//takes a string view so lookups can hash the line buffer directly
+struct MurmurHash {
+    unsigned int operator()(std::string_view key) const
+    {
+        return MurmurHash2(key.data(), key.size(), MURMURHASH2_SEED);
+    }
+};
+
+//state for one thread replaying lookups when measuring throughput
+template<class T> struct LookupThread {
+    T *table;
+    const std::vector<std::string> *keys;
+    size_t start;
+    size_t found;
+};
+
+template<class T> void *run_lookups(void *arg)
+{
+    LookupThread<T> *t = (LookupThread<T> *)arg;
+
+    size_t n = t->keys->size();
+    for (size_t i = 0; i < n; ++i) {
+        int value;
+        if (t->table->find((*t->keys)[(t->start + i) % n], value)) ++t->found;
+    }
+
+    return 0;
+}
+
+//run the lookups on 1 to max_threads threads, each thread replaying every
+//lookup starting from a different offset, and report lookups per second
+template<class T> void measure_throughput(T *table, const std::vector<std::string> &keys, int max_threads)
+{
+    if (keys.empty()) return;
+
+    std::vector<pthread_t> threads(max_threads);
+    std::vector<LookupThread<T> > args(max_threads);
+
+    for (int nthreads = 1; nthreads <= max_threads; ++nthreads) {
+
+        timeval begin, end;
+        gettimeofday(&begin, 0);
+
+        for (int i = 0; i < nthreads; ++i) {
+            args[i].table = table;
+            args[i].keys = &keys;
+            args[i].start = i * keys.size() / nthreads;
+            args[i].found = 0;
+            pthread_create(&threads[i], 0, run_lookups<T>, &args[i]);
+        }
+
+        for (int i = 0; i < nthreads; ++i) pthread_join(threads[i], 0);
+
+        gettimeofday(&end, 0);
+
+        double seconds = (end.tv_sec - begin.tv_sec) + (end.tv_usec - begin.tv_usec) / 1000000.0;
+        double lookups = (double)keys.size() * nthreads;
+        std::cout << "threads: " << nthreads << " lookups/s: " << (size_t)(lookups / seconds) << "\n";
+    }
+}
+
+//monotonic clock in nanoseconds, for timing single lookups
+uint64_t now_ns()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+//report the median and tail of the lookup times in ns, which include the
+//cost of reading the clock
+void report_latency(std::vector<uint64_t> &ns)
+{
+    if (ns.empty()) return;
+
+    std::sort(ns.begin(), ns.end());
+    std::cout << "lookup ns p50: " << ns[ns.size() / 2]
+        << " p99: " << ns[ns.size() * 99 / 100]
+        << " p99.9: " << ns[ns.size() * 999 / 1000]
+        << " max: " << ns.back() << "\n";
+}
+
+template<class T> bool item_less(const T &a, const T &b)
+{
+    return a.key < b.key;
+}
+
+//sort items by key, keeping the first of equal keys first, and build the
+//treap from them in one pass
+template<class T, class Item> void bulk_build(T *treap, std::vector<Item> &items)
+{
+    std::cerr << "bulk building " << items.size() << " items" << "\n";
+    std::stable_sort(items.begin(), items.end(), item_less<Item>);
+    treap->build(items.begin(), items.end());
+    items.clear();
+}
+
+//look up the queued searches with one call to find_batch and print the
+//results in order
+template<class T> void flush_batch(T *ht, std::vector<std::string_view> &keys, std::vector<int *> &results, int &pending)
+{
+    ht->find_batch(&keys[0], pending, &results[0]);
+
+    for (int i = 0; i < pending; ++i) {
+        if (results[i]) {
+            std::cout << keys[i] << ": " << *results[i] << "\n"; 
+        } else { 
+            std::cout << keys[i] << ": not found" << "\n"; 
+        }
+    }
+
+    pending = 0;
+}
+
+void usage()
 {
-    return MurmurHash2(key.c_str(), key.size(), MURMURHASH2_SEED);
+    std::cerr << "usage: -map | -treap | -top-down-treap | -skiplist | -deterministic-skiplist | -hashtable | -open-hashtable | -group-hashtable | -concurrent-hashtable | -concurrent-skiplist | -splaytree | -nop <operations> [-self-adjust | -adaptive] [-frozen] [-finger] [-latency] [-seed=n] [-size=n] [-threads=n] [-batch=n]" << "\n";
 }
 
 int main(int argc, char **argv)
@@ -50,18 +175,22 @@ int main(int argc, char **argv)
 
     //check command line
     if (argc < 3) {
-        std::cerr << "usage: -map | -treap | -skiplist | -hashtable | -splaytree | -nop <operations> [-self-adjust] [-size=n]" << "\n";
+        usage();
         return 1; 
     }
 
-    //see if we should adapt weights
+    //see if we should adapt weights, and the hash table size.  Options
+    //may come in any order after the data file.
     bool self_adjust = false;
-    if (argc >= 4) {
-        if (!strncmp(argv[3], "-self-adjust", 15)) {
-            self_adjust = true;
-            std::cerr << "using self adjusting version" << std::endl;
-        }
+    bool adaptive = false;
+    int size = 1000;
+    for (int i = 3; i < argc; ++i) {
+        if (!strcmp(argv[i], "-self-adjust")) self_adjust = true;
+        else if (!strcmp(argv[i], "-adaptive")) adaptive = true;
+        sscanf(argv[i], "-size=%d", &size);
     }
+    if (self_adjust) std::cerr << "using self adjusting version" << std::endl;
+    else if (adaptive) std::cerr << "using adaptive version" << std::endl;
 
     //read data file
     std::ifstream data(argv[2]);
@@ -71,15 +200,17 @@ int main(int argc, char **argv)
         return 1;
     } 
 
-    //pick random seed
-    int seed = time(0);
+    //the structures own their random number generators and are seeded from
+    //the command line, so runs are repeatable
+    unsigned long seed = 1;
+    for (int i = 3; i < argc; ++i) sscanf(argv[i], "-seed=%lu", &seed);
     srand(seed);
     std::cout << "random seed: " << seed << "\n";
 
     //see which data structure to use and run operations on it
     if (!strcmp(argv[1], "-map")) {
 
-        std::map<std::string, int> map;
+        std::map<std::string, int, std::less<> > map;
 
         char cmd[80];
         while (!data.eof()) {
@@ -95,17 +226,17 @@ int main(int argc, char **argv)
 
                 map[key] = 0;
             } else if (cmd[0] == 's') {
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
 
-                std::map<std::string, int>::iterator itor = map.find(key);
+                std::map<std::string, int, std::less<> >::iterator itor = map.find(key);
 
                 if (itor != map.end()) std::cout << key << ": " << itor->second << "\n";
                 else std::cout << key << ": not found" << "\n"; 
 
             } else if (cmd[1] == 'd') { 
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
 
-                std::map<std::string, int>::iterator itor = map.find(key);
+                std::map<std::string, int, std::less<> >::iterator itor = map.find(key);
 
                 if (itor != map.end()) {
                     map.erase(itor);
@@ -115,7 +246,92 @@ int main(int argc, char **argv)
 
     } else if (!strcmp(argv[1], "-treap")) {
 
-        BiasedTreap<std::string, int> *treap = new BiasedTreap<std::string, int>(self_adjust);
+        BiasedTreap<std::string, int> *treap;
+        if (adaptive) {
+            treap = new BiasedTreap<std::string, int>(BiasedTreap<std::string, int>::ADAPTIVE, seed);
+        } else {
+            treap = new BiasedTreap<std::string, int>(self_adjust, seed);
+        }
+
+        //with -frozen searches go to a snapshot which is refrozen after
+        //the treap changes
+        bool frozen = false;
+        for (int i = 3; i < argc; ++i) {
+            if (!strcmp(argv[i], "-frozen")) frozen = true;
+        }
+        FrozenBiasedTreap<std::string, int> snapshot;
+        bool stale = true;
+
+        //the leading run of inserts is sorted and bulk built
+        std::vector<BiasedTreap<std::string, int>::Item> items;
+        bool loading = true;
+
+        char cmd[80];
+        while (!data.eof()) {
+            data.getline(cmd, 80); 
+
+            //generated data files start with ; comment lines
+            if (loading && cmd[0] != 'i' && cmd[0] != ';') {
+                bulk_build(treap, items);
+                loading = false;
+            }
+
+            if (cmd[0] == 'i') {
+
+                //extract word
+                size_t i = 2;
+                while (cmd[i] != ' ') ++i;
+                cmd[i] = 0;
+                std::string key(&cmd[2]);
+
+                //extract weight
+                ++i;
+                size_t weight = atoi(&cmd[i]); 
+
+                if (loading) {
+                    BiasedTreap<std::string, int>::Item item = {key, 0, weight};
+                    items.push_back(item);
+                } else {
+                    treap->insert(key, 0, weight); 
+                    stale = true;
+                }
+            } else if (cmd[0] == 's' && frozen) {
+                std::string_view key(&cmd[2]); 
+
+                if (stale) {
+                    snapshot = treap->freeze();
+                    stale = false;
+                }
+
+                const int *result = snapshot.find(key);
+                if (result) {
+                    std::cout << key << ": " << *result << "\n"; 
+                } else { 
+                    std::cout << key << ": not found" << "\n";
+                }
+
+            } else if (cmd[0] == 's') {
+                std::string_view key(&cmd[2]); 
+
+                int *result = treap->find(key);
+                if (result) {
+                    std::cout << key << ": " << *result << "\n"; 
+                } else { 
+                    std::cout << key << ": not found" << "\n";
+                }
+
+            } else if (cmd[1] == 'd') { 
+                std::string_view key(&cmd[2]); 
+                treap->remove(key);
+                stale = true;
+            } 
+        }
+
+        if (loading) bulk_build(treap, items);
+
+    } else if (!strcmp(argv[1], "-top-down-treap")) {
+
+        TopDownBiasedTreap<std::string, int> *treap = new TopDownBiasedTreap<std::string, int>(self_adjust, seed);
 
         char cmd[80];
         while (!data.eof()) {
@@ -135,7 +351,7 @@ int main(int argc, char **argv)
 
                 treap->insert(key, 0, weight); 
             } else if (cmd[0] == 's') {
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
 
                 int *result = treap->find(key);
                 if (result) {
@@ -145,19 +361,88 @@ int main(int argc, char **argv)
                 }
 
             } else if (cmd[1] == 'd') { 
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
                 treap->remove(key);
             } 
         }
 
     } else if (!strcmp(argv[1], "-skiplist")) {
 
+        BiasedSkiplist<std::string, int> *skiplist;
+        if (self_adjust) {
+            skiplist = new BiasedSkiplist<std::string, int>(32, BiasedSkiplist<std::string, int>::SELF_ADJUST, seed);
+        } else {
+            skiplist = new BiasedSkiplist<std::string, int>(32, seed);
+        }
+
+        //with -finger inserts and searches start from where the last one
+        //ended, which pays off when nearby keys are accessed together
+        bool use_finger = false;
+        for (int i = 3; i < argc; ++i) {
+            if (!strcmp(argv[i], "-finger")) use_finger = true;
+        }
+        BiasedSkiplist<std::string, int>::Finger finger(*skiplist);
+
+        //with -latency each search is timed
+        bool latency = false;
+        for (int i = 3; i < argc; ++i) {
+            if (!strcmp(argv[i], "-latency")) latency = true;
+        }
+        std::vector<uint64_t> times;
+
+        char cmd[80];
+        while (!data.eof()) {
+            data.getline(cmd, 80); 
+
+            if (cmd[0] == 'i') {
+
+                //extract word
+                size_t i = 2;
+                while (cmd[i] != ' ') ++i;
+                cmd[i] = 0;
+                std::string key(&cmd[2]);
+
+                //extract weight
+                ++i;
+                size_t weight = atoi(&cmd[i]); 
+
+                if (use_finger) skiplist->insert(finger, key, 0, weight);
+                else skiplist->insert(key, 0, weight); 
+            } else if (cmd[0] == 's') {
+                std::string_view key(&cmd[2]); 
+
+                uint64_t start = latency ? now_ns() : 0;
+                int *result = use_finger ? skiplist->find(finger, key) : skiplist->find(key);
+                if (latency) times.push_back(now_ns() - start);
+
+                if (result) {
+                    std::cout << key << ": " << *result << "\n"; 
+                } else { 
+                    std::cout << key << ": not found" << "\n"; 
+                }
+
+            } else if (cmd[1] == 'd') { 
+                std::string_view key(&cmd[2]); 
+                skiplist->remove(key);
+            } 
+        } 
+
+        if (latency) report_latency(times);
+
+    } else if (!strcmp(argv[1], "-deterministic-skiplist")) {
+
         if (self_adjust) {
-            std::cerr << "error: self-adjusting mode not supported by biased skiplists.\n";
+            std::cerr << "error: self-adjusting mode not supported by deterministic skiplists.\n";
             return 1; 
         }
 
-        BiasedSkiplist<std::string, int> *skiplist = new BiasedSkiplist<std::string, int>(32);
+        DeterministicBiasedSkiplist<std::string, int> *skiplist = new DeterministicBiasedSkiplist<std::string, int>(32);
+
+        bool latency = false;
+        for (int i = 3; i < argc; ++i) {
+            if (!strcmp(argv[i], "-latency")) latency = true;
+        }
+        std::vector<uint64_t> times;
 
         char cmd[80];
         while (!data.eof()) {
@@ -177,9 +462,12 @@ int main(int argc, char **argv)
 
                 skiplist->insert(key, 0, weight); 
             } else if (cmd[0] == 's') {
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
 
+                uint64_t start = latency ? now_ns() : 0;
                 int *result = skiplist->find(key);
+                if (latency) times.push_back(now_ns() - start);
+
                 if (result) {
                     std::cout << key << ": " << *result << "\n"; 
                 } else { 
@@ -187,25 +475,43 @@ int main(int argc, char **argv)
                 }
 
             } else if (cmd[1] == 'd') { 
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
                 skiplist->remove(key);
             } 
         } 
 
+        if (latency) report_latency(times);
+
     } else if (!strcmp(argv[1], "-hashtable")) {
 
-        if (!self_adjust) {
+        //with -batch=n, runs of up to n searches are looked up with find_batch
+        int batch = 0;
+        for (int i = 3; i < argc; ++i) sscanf(argv[i], "-batch=%d", &batch);
+        if (batch < 0) batch = 0;
+
+        //searches are queued in place, so each queued line needs its own buffer
+        std::vector<char> lines((batch > 0 ? batch : 1) * 80);
+        std::vector<std::string_view> keys(batch);
+        std::vector<int *> results(batch);
+        int pending = 0;
 
-            int size;
-            if (argc < 4 || !sscanf(argv[3], "-size=%d", &size)) size = 1000;
+        if (!self_adjust) {
 
             std::cerr << "hash table size: " << size << "\n";
-            BiasedHashtable<std::string, int> *ht = new BiasedHashtable<std::string, int>(size, hash);
+            BiasedHashtable<std::string, int, MurmurHash> *ht = new BiasedHashtable<std::string, int, MurmurHash>(size);
 
-            char cmd[80];
             while (!data.eof()) {
+                char *cmd = &lines[pending * 80];
                 data.getline(cmd, 80); 
 
+                //queue searches, anything else first runs the queued ones
+                if (batch > 0 && cmd[0] == 's') {
+                    keys[pending++] = std::string_view(&cmd[2]);
+                    if (pending == batch) flush_batch(ht, keys, results, pending);
+                    continue;
+                }
+                if (pending) flush_batch(ht, keys, results, pending);
+
                 if (cmd[0] == 'i') {
 
                     //extract word
@@ -220,7 +526,7 @@ int main(int argc, char **argv)
 
                     ht->insert(key, 0, weight); 
                 } else if (cmd[0] == 's') {
-                    std::string key(&cmd[2]); 
+                    std::string_view key(&cmd[2]); 
 
                     int *result = ht->find(key); 
                     if (result) {
@@ -230,23 +536,30 @@ int main(int argc, char **argv)
                     }
 
                 } else if (cmd[1] == 'd') { 
-                    std::string key(&cmd[2]); 
+                    std::string_view key(&cmd[2]); 
                     ht->remove(key);
                 } 
             }
-        } else {
 
-            int size;
-            if (argc < 5 || !sscanf(argv[4], "-size=%d", &size)) size = 1000;
+            if (pending) flush_batch(ht, keys, results, pending);
+        } else {
 
             std::cerr << "hash table size: " << size << "\n";
 
-            SelfAdjustingBiasedHashtable<std::string, int> *ht = new SelfAdjustingBiasedHashtable<std::string, int>(size, hash);
+            SelfAdjustingBiasedHashtable<std::string, int, MurmurHash> *ht = new SelfAdjustingBiasedHashtable<std::string, int, MurmurHash>(size);
 
-            char cmd[80];
             while (!data.eof()) {
+                char *cmd = &lines[pending * 80];
                 data.getline(cmd, 80); 
 
+                //queue searches, anything else first runs the queued ones
+                if (batch > 0 && cmd[0] == 's') {
+                    keys[pending++] = std::string_view(&cmd[2]);
+                    if (pending == batch) flush_batch(ht, keys, results, pending);
+                    continue;
+                }
+                if (pending) flush_batch(ht, keys, results, pending);
+
                 if (cmd[0] == 'i') {
 
                     //extract word
@@ -257,7 +570,7 @@ int main(int argc, char **argv)
 
                     ht->insert(key, 0); 
                 } else if (cmd[0] == 's') {
-                    std::string key(&cmd[2]); 
+                    std::string_view key(&cmd[2]); 
 
                     int *result = ht->find(key); 
                     if (result) {
@@ -267,12 +580,207 @@ int main(int argc, char **argv)
                     }
 
                 } else if (cmd[1] == 'd') { 
-                    std::string key(&cmd[2]); 
+                    std::string_view key(&cmd[2]); 
                     ht->remove(key);
                 } 
 
             }
+
+            if (pending) flush_batch(ht, keys, results, pending);
+        }
+    } else if (!strcmp(argv[1], "-open-hashtable")) {
+
+        if (self_adjust) {
+            std::cerr << "error: self-adjusting mode not supported by open addressing hash tables.\n";
+            return 1; 
+        }
+
+        std::cerr << "hash table size: " << size << "\n";
+        RobinHoodBiasedHashtable<std::string, int, MurmurHash> *ht = new RobinHoodBiasedHashtable<std::string, int, MurmurHash>(size);
+
+        char cmd[80];
+        while (!data.eof()) {
+            data.getline(cmd, 80); 
+
+            if (cmd[0] == 'i') {
+
+                //extract word
+                size_t i = 2;
+                while (cmd[i] != ' ') ++i;
+                cmd[i] = 0;
+                std::string key(&cmd[2]);
+
+                //extract weight
+                ++i;
+                size_t weight = atoi(&cmd[i]);
+
+                ht->insert(key, 0, weight); 
+            } else if (cmd[0] == 's') {
+                std::string_view key(&cmd[2]); 
+
+                int *result = ht->find(key); 
+                if (result) {
+                    std::cout << key << ": " << *result << "\n"; 
+                } else { 
+                    std::cout << key << ": not found" << "\n"; 
+                }
+
+            } else if (cmd[1] == 'd') { 
+                std::string_view key(&cmd[2]); 
+                ht->remove(key);
+            } 
+        }
+
+    } else if (!strcmp(argv[1], "-group-hashtable")) {
+
+        if (self_adjust) {
+            std::cerr << "error: self-adjusting mode not supported by grouped hash tables.\n";
+            return 1; 
+        }
+
+        std::cerr << "hash table size: " << size << "\n";
+        GroupedBiasedHashtable<std::string, int, MurmurHash> *ht = new GroupedBiasedHashtable<std::string, int, MurmurHash>(size);
+
+        char cmd[80];
+        while (!data.eof()) {
+            data.getline(cmd, 80); 
+
+            if (cmd[0] == 'i') {
+
+                //extract word
+                size_t i = 2;
+                while (cmd[i] != ' ') ++i;
+                cmd[i] = 0;
+                std::string key(&cmd[2]);
+
+                //extract weight
+                ++i;
+                size_t weight = atoi(&cmd[i]);
+
+                ht->insert(key, 0, weight); 
+            } else if (cmd[0] == 's') {
+                std::string_view key(&cmd[2]); 
+
+                int *result = ht->find(key); 
+                if (result) {
+                    std::cout << key << ": " << *result << "\n"; 
+                } else { 
+                    std::cout << key << ": not found" << "\n"; 
+                }
+
+            } else if (cmd[1] == 'd') { 
+                std::string_view key(&cmd[2]); 
+                ht->remove(key);
+            } 
+        }
+
+    } else if (!strcmp(argv[1], "-concurrent-hashtable")) {
+
+        //options may come in any order
+        int threads = 1;
+        for (int i = 3; i < argc; ++i) sscanf(argv[i], "-threads=%d", &threads);
+        if (threads < 1) threads = 1;
+
+        if (!self_adjust) {
+
+            std::cerr << "hash table size: " << size << "\n";
+            ConcurrentBiasedHashtable<std::string, int, MurmurHash> *ht = new ConcurrentBiasedHashtable<std::string, int, MurmurHash>(size);
+
+            //load inserts, then time the searches from increasing numbers of threads
+            std::vector<std::string> searches;
+
+            char cmd[80];
+            while (!data.eof()) {
+                data.getline(cmd, 80); 
+
+                if (cmd[0] == 'i') {
+
+                    //extract word
+                    size_t i = 2;
+                    while (cmd[i] != ' ') ++i;
+                    cmd[i] = 0;
+                    std::string key(&cmd[2]);
+
+                    //extract weight
+                    ++i;
+                    size_t weight = atoi(&cmd[i]);
+
+                    ht->insert(key, 0, weight); 
+                } else if (cmd[0] == 's') {
+                    searches.push_back(std::string(&cmd[2]));
+                }
+            }
+
+            measure_throughput(ht, searches, threads);
+        } else {
+
+            std::cerr << "hash table size: " << size << "\n";
+            ConcurrentSelfAdjustingBiasedHashtable<std::string, int, MurmurHash> *ht = new ConcurrentSelfAdjustingBiasedHashtable<std::string, int, MurmurHash>(size);
+
+            //load inserts, then time the searches from increasing numbers of threads
+            std::vector<std::string> searches;
+
+            char cmd[80];
+            while (!data.eof()) {
+                data.getline(cmd, 80); 
+
+                if (cmd[0] == 'i') {
+
+                    //extract word
+                    size_t i = 2;
+                    while (cmd[i] != ' ') ++i;
+                    cmd[i] = 0;
+                    std::string key(&cmd[2]);
+
+                    ht->insert(key, 0); 
+                } else if (cmd[0] == 's') {
+                    searches.push_back(std::string(&cmd[2]));
+                }
+            }
+
+            measure_throughput(ht, searches, threads);
         }
+
+    } else if (!strcmp(argv[1], "-concurrent-skiplist")) {
+
+        if (self_adjust) {
+            std::cerr << "error: self-adjusting mode not supported by concurrent skiplists.\n";
+            return 1; 
+        }
+
+        int threads = 1;
+        for (int i = 3; i < argc; ++i) sscanf(argv[i], "-threads=%d", &threads);
+        if (threads < 1) threads = 1;
+
+        ConcurrentBiasedSkiplist<std::string, int> *skiplist = new ConcurrentBiasedSkiplist<std::string, int>(32, seed);
+
+        //load inserts, then time the searches from increasing numbers of threads
+        std::vector<std::string> searches;
+
+        char cmd[80];
+        while (!data.eof()) {
+            data.getline(cmd, 80); 
+
+            if (cmd[0] == 'i') {
+
+                //extract word
+                size_t i = 2;
+                while (cmd[i] != ' ') ++i;
+                cmd[i] = 0;
+                std::string key(&cmd[2]);
+
+                //extract weight
+                ++i;
+                size_t weight = atoi(&cmd[i]);
+
+                skiplist->insert(key, 0, weight); 
+            } else if (cmd[0] == 's') {
+                searches.push_back(std::string(&cmd[2]));
+            }
+        }
+
+        measure_throughput(skiplist, searches, threads);
+
     } else if (!strcmp(argv[1], "-splaytree")) {
 
         if (!self_adjust) {
@@ -296,7 +804,7 @@ int main(int argc, char **argv)
 
                 splaytree->insert(key, 0); 
             } else if (cmd[0] == 's') {
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
 
                 int *result = splaytree->find(key);
                 if (result) {
@@ -306,7 +814,7 @@ int main(int argc, char **argv)
                 }
 
             } else if (cmd[1] == 'd') { 
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
                 splaytree->remove(key);
             } 
         } 
@@ -326,17 +834,17 @@ int main(int argc, char **argv)
                 std::string key(&cmd[2]);
 
             } else if (cmd[0] == 's') {
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
 
                 int result = -1;
                 std::cout << key << ": " << result << "\n"; 
             } else if (cmd[1] == 'd') { 
-                std::string key(&cmd[2]); 
+                std::string_view key(&cmd[2]); 
             } 
         }
 
     } else {
-        std::cerr << "usage: -map | -treap | -skiplist | -hashtable | -splaytree | -nop <operations> [-self-adjust]" << "\n";
+        usage();
         return 1; 
     }
 
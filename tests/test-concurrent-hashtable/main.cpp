@@ -0,0 +1,406 @@
+/*
+Copyright (c) 2011 Daniel Minor 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <string> 
+#include <vector>
+
+#include <pthread.h>
+
+#include "concurrent_biased_hashtable.h"
+
+const unsigned int MURMURHASH2_SEED = 0x5432FEDC;
+
+unsigned int MurmurHash2 ( const void * key, int len, unsigned int seed );
+
+struct MurmurHash {
+    unsigned int operator()(const std::string &key) const
+    {
+        return MurmurHash2(key.c_str(), key.size(), MURMURHASH2_SEED);
+    }
+};
+
+typedef ConcurrentBiasedHashtable<std::string, int, MurmurHash> Hashtable;
+typedef ConcurrentSelfAdjustingBiasedHashtable<std::string, int, MurmurHash> SelfAdjustingHashtable;
+
+void insert(Hashtable *ht, const std::string &key, int value)
+{
+    ht->insert(key, value, rand()%10);
+}
+
+void insert(SelfAdjustingHashtable *ht, const std::string &key, int value)
+{
+    ht->insert(key, value);
+}
+
+template<class T> void runtests(T *ht, const std::vector<std::pair<std::string, int> > &elements)
+{
+    //try finding the elements
+    std::cout << "testing find...\n"; 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int value;
+        if (!ht->find(elements[i].first, value) || value != elements[i].second) {
+            std::cerr << "error: find failed to locate element...\n";
+        } 
+    }
+
+    //try removing half of the elements 
+    std::cout << "testing remove...\n"; 
+    size_t begin_remove_index = elements.size() / 4;
+    size_t end_remove_index = begin_remove_index + elements.size() / 2;
+
+    for (size_t i = begin_remove_index; i < end_remove_index; ++i) { 
+        ht->remove(elements[i].first);
+    } 
+
+    //try finding the elements 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int value;
+        bool found = ht->find(elements[i].first, value);
+
+        if ((i < begin_remove_index || i >= end_remove_index) && !found) {
+            std::cerr << "error: find failed to locate element " << i << "...\n";
+        } else if (i >= begin_remove_index && i < end_remove_index && found) {
+            std::cerr << "error: find found deleted element " << i << "...\n"; 
+        } 
+    }
+}
+
+template<class T> struct Worker {
+    T *ht;
+    const std::vector<std::pair<std::string, int> > *elements;
+    size_t begin;
+    size_t end;
+    size_t found;
+};
+
+template<class T> void *insert_worker(void *arg)
+{
+    Worker<T> *w = (Worker<T> *)arg;
+    for (size_t i = w->begin; i < w->end; ++i) {
+        insert(w->ht, (*w->elements)[i].first, (*w->elements)[i].second);
+    }
+
+    return 0;
+}
+
+template<class T> void *find_worker(void *arg)
+{
+    Worker<T> *w = (Worker<T> *)arg;
+    for (size_t i = 0; i < w->elements->size(); ++i) {
+        int value;
+        if (w->ht->find((*w->elements)[i].first, value)) ++w->found;
+    }
+
+    return 0;
+}
+
+const int TEST_SIZE = 1000;
+const int STRING_SIZE = 8;
+const int THREADS = 4;
+const int HITS = 10;
+
+template<class T> void runsinglethreadtests(T *ht, const std::vector<std::pair<std::string, int> > &elements)
+{
+    std::cout << "testing single threaded...\n";
+
+    //insert into the hash table 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        insert(ht, elements[i].first, elements[i].second);
+    } 
+
+    runtests(ht, elements); 
+}
+
+struct HotWorker {
+    SelfAdjustingHashtable *ht;
+    std::string key;
+};
+
+void *hot_worker(void *arg)
+{
+    HotWorker *w = (HotWorker *)arg;
+    for (int i = 0; i < HITS; ++i) {
+        int value;
+        w->ht->find(w->key, value);
+    }
+
+    //exits without flushing, so its hits are applied on the way out
+    return 0;
+}
+
+void runpromotiontests(const std::vector<std::pair<std::string, int> > &elements)
+{
+    //few buckets and no growing, so the chains are long
+    std::cout << "testing promotion...\n";
+    SelfAdjustingHashtable *ht = new SelfAdjustingHashtable(4, MurmurHash(), 4, (float)elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) {
+        insert(ht, elements[i].first, elements[i].second);
+    }
+
+    //the first key inserted is at the back of its chain
+    const std::string &key = elements[0].first;
+    size_t d;
+    if (!ht->depth(key, d) || d == 0) {
+        std::cerr << "error: first key inserted at head of chain...\n";
+    }
+
+    for (int i = 0; i < HITS; ++i) {
+        int value;
+        ht->find(key, value);
+    }
+    ht->flush();
+
+    if (!ht->depth(key, d) || d != 0) {
+        std::cerr << "error: hit key not at head of chain after flush...\n";
+    }
+
+    //hits logged by a thread which exits are not lost
+    HotWorker w;
+    w.ht = ht;
+    w.key = elements[1].first;
+    if (!ht->depth(w.key, d) || d == 0) {
+        std::cerr << "error: second key inserted at head of chain...\n";
+    }
+
+    pthread_t thread;
+    pthread_create(&thread, 0, hot_worker, &w);
+    pthread_join(thread, 0);
+
+    if (!ht->depth(w.key, d) || d != 0) {
+        std::cerr << "error: hit key not at head of chain after thread exit...\n";
+    }
+
+    delete ht;
+}
+
+struct ChurnWorker {
+    SelfAdjustingHashtable *ht;
+    const std::vector<std::pair<std::string, int> > *elements;
+    unsigned int seed;
+    size_t misses;
+    bool *done;
+};
+
+//look up keys which stay in the table, skewed towards a few so they are
+//moved to the front of their chains while other threads walk past them
+void *stable_worker(void *arg)
+{
+    ChurnWorker *w = (ChurnWorker *)arg;
+    size_t stable = w->elements->size() / 2;
+    for (int i = 0; i < 20000; ++i) {
+        w->seed = w->seed * 1103515245 + 12345;
+        size_t j = (w->seed >> 16) % stable;
+        if (i % 2) j %= 8;
+
+        int value;
+        if (!w->ht->find((*w->elements)[j].first, value) || value != (*w->elements)[j].second) ++w->misses;
+    }
+
+    return 0;
+}
+
+//remove and reinsert the other half of the keys, so nodes are retired and
+//reused while finds may be reading them
+void *churn_worker(void *arg)
+{
+    ChurnWorker *w = (ChurnWorker *)arg;
+    size_t stable = w->elements->size() / 2;
+    while (!__atomic_load_n(w->done, __ATOMIC_RELAXED)) {
+        for (size_t i = stable; i < w->elements->size(); ++i) w->ht->remove((*w->elements)[i].first);
+        for (size_t i = stable; i < w->elements->size(); ++i) insert(w->ht, (*w->elements)[i].first, (*w->elements)[i].second);
+    }
+
+    return 0;
+}
+
+void runlockfreetests(const std::vector<std::pair<std::string, int> > &elements)
+{
+    //few buckets to start with, so chains are long and the table grows
+    //while the finds run
+    std::cout << "testing finds during promotions and removes...\n";
+    SelfAdjustingHashtable *ht = new SelfAdjustingHashtable(8, MurmurHash(), 4);
+    for (size_t i = 0; i < elements.size() / 2; ++i) {
+        insert(ht, elements[i].first, elements[i].second);
+    }
+
+    bool done = false;
+    pthread_t threads[THREADS + 1];
+    ChurnWorker workers[THREADS + 1];
+    for (int i = 0; i <= THREADS; ++i) {
+        workers[i].ht = ht;
+        workers[i].elements = &elements;
+        workers[i].seed = i + 1;
+        workers[i].misses = 0;
+        workers[i].done = &done;
+        pthread_create(&threads[i], 0, i < THREADS ? stable_worker : churn_worker, &workers[i]);
+    }
+
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], 0);
+        if (workers[i].misses) {
+            std::cerr << "error: thread " << i << " missed " << workers[i].misses << " keys never removed...\n";
+        }
+    }
+
+    __atomic_store_n(&done, true, __ATOMIC_RELAXED);
+    pthread_join(threads[THREADS], 0);
+
+    delete ht;
+}
+
+template<class T> void runthreadtests(T *ht, const std::vector<std::pair<std::string, int> > &elements)
+{
+    //insert from several threads at once, then find from several threads
+    std::cout << "testing threaded insert and find...\n";
+    pthread_t threads[THREADS];
+    Worker<T> workers[THREADS];
+    for (int i = 0; i < THREADS; ++i) {
+        workers[i].ht = ht;
+        workers[i].elements = &elements;
+        workers[i].begin = i * elements.size() / THREADS;
+        workers[i].end = (i + 1) * elements.size() / THREADS;
+        workers[i].found = 0;
+        pthread_create(&threads[i], 0, insert_worker<T>, &workers[i]);
+    }
+
+    for (int i = 0; i < THREADS; ++i) pthread_join(threads[i], 0);
+
+    for (int i = 0; i < THREADS; ++i) pthread_create(&threads[i], 0, find_worker<T>, &workers[i]);
+
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], 0);
+        if (workers[i].found != elements.size()) {
+            std::cerr << "error: thread " << i << " found " << workers[i].found << " elements...\n";
+        }
+    }
+
+    runtests(ht, elements);
+}
+
+int main(int argc, char **argv)
+{
+    //create some elements to test against
+    std::vector<std::pair<std::string, int> > elements;
+    for (int i = 0; i < TEST_SIZE; ++i) {
+
+        //random string
+        char k[STRING_SIZE];
+        for (int j = 0; j < STRING_SIZE - 1; ++j) {
+            k[j] = (char)(96 + rand()%25);
+        }
+        k[STRING_SIZE - 1] = 0;
+
+        elements.push_back(std::make_pair<std::string, int>(k, i + 1));
+    }
+
+    //do tests in biased mode
+    std::cout << "testing in biased mode\n";
+    Hashtable *ht = new Hashtable(8, MurmurHash(), 4);
+    runsinglethreadtests(ht, elements);
+    delete ht;
+
+    ht = new Hashtable(8, MurmurHash(), 4);
+    runthreadtests(ht, elements);
+    delete ht;
+
+    //do tests in self-adjusting mode
+    std::cout << "testing in self-adjusting mode\n";
+    SelfAdjustingHashtable *saht = new SelfAdjustingHashtable(8, MurmurHash(), 4);
+    runsinglethreadtests(saht, elements);
+    delete saht;
+
+    saht = new SelfAdjustingHashtable(8, MurmurHash(), 4);
+    runthreadtests(saht, elements);
+    delete saht;
+
+    runpromotiontests(elements);
+    runlockfreetests(elements);
+
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// MurmurHash2, by Austin Appleby
+
+// Note - This code makes a few assumptions about how your machine behaves -
+
+// 1. We can read a 4-byte value from any address without crashing
+// 2. sizeof(int) == 4
+
+// And it has a few limitations -
+
+// 1. It will not work incrementally.
+// 2. It will not produce the same results on little-endian and big-endian
+//    machines.
+
+unsigned int MurmurHash2 ( const void * key, int len, unsigned int seed )
+{
+	// 'm' and 'r' are mixing constants generated offline.
+	// They're not really 'magic', they just happen to work well.
+
+	const unsigned int m = 0x5bd1e995;
+	const int r = 24;
+
+	// Initialize the hash to a 'random' value
+
+	unsigned int h = seed ^ len;
+
+	// Mix 4 bytes at a time into the hash
+
+	const unsigned char * data = (const unsigned char *)key;
+
+	while(len >= 4)
+	{
+		unsigned int k = *(unsigned int *)data;
+
+		k *= m; 
+		k ^= k >> r; 
+		k *= m; 
+		
+		h *= m; 
+		h ^= k;
+
+		data += 4;
+		len -= 4;
+	}
+	
+	// Handle the last few bytes of the input array
+
+	switch(len)
+	{
+	case 3: h ^= data[2] << 16;
+	case 2: h ^= data[1] << 8;
+	case 1: h ^= data[0];
+	        h *= m;
+	};
+
+	// Do a few final mixes of the hash to ensure the last few
+	// bytes are well-incorporated.
+
+	h ^= h >> 13;
+	h *= m;
+	h ^= h >> 15;
+
+	return h;
+}
@@ -0,0 +1,241 @@
+/*
+Copyright (c) 2011 Daniel Minor 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <string> 
+#include <vector>
+
+#include <pthread.h>
+
+#include "concurrent_biased_skiplist.h"
+
+typedef ConcurrentBiasedSkiplist<std::string, int> Skiplist;
+
+void runtests(Skiplist *sl, const std::vector<std::pair<std::string, int> > &elements)
+{
+    //try finding the elements
+    std::cout << "testing find...\n"; 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int value;
+        if (!sl->find(elements[i].first, value) || value != elements[i].second) {
+            std::cerr << "error: find failed to locate element...\n";
+        } 
+    }
+
+    //try finding the elements without building a std::string
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int value;
+        if (!sl->find(elements[i].first.c_str(), value)) {
+            std::cerr << "error: find failed to locate element by const char *...\n";
+        }
+    }
+
+    //try removing half of the elements, and some absent keys
+    std::cout << "testing remove...\n"; 
+    size_t begin_remove_index = elements.size() / 4;
+    size_t end_remove_index = begin_remove_index + elements.size() / 2;
+
+    for (size_t i = begin_remove_index; i < end_remove_index; ++i) { 
+        sl->remove(elements[i].first);
+        sl->remove(elements[i].first + "a");
+    } 
+
+    //try finding the elements 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int value;
+        bool found = sl->find(elements[i].first, value);
+
+        if ((i < begin_remove_index || i >= end_remove_index) && !found) {
+            std::cerr << "error: find failed to locate element " << i << "...\n";
+        } else if (i >= begin_remove_index && i < end_remove_index && found) {
+            std::cerr << "error: find found deleted element " << i << "...\n"; 
+        } 
+    }
+}
+
+struct Worker {
+    Skiplist *sl;
+    const std::vector<std::pair<std::string, int> > *elements;
+    size_t begin;
+    size_t end;
+    size_t found;
+    uint64_t seed;
+};
+
+//rand() is not thread safe, so each thread draws weights from its own
+//generator
+void *insert_worker(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    XorShiftRandom random(w->seed);
+    for (size_t i = w->begin; i < w->end; ++i) {
+        w->sl->insert((*w->elements)[i].first, (*w->elements)[i].second, random.next()%10);
+    }
+
+    return 0;
+}
+
+void *find_worker(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    for (size_t i = 0; i < w->elements->size(); ++i) {
+        int value;
+        if (w->sl->find((*w->elements)[i].first, value)) ++w->found;
+    }
+
+    return 0;
+}
+
+const int CHURN_ROUNDS = 50;
+
+//every thread inserts and removes its own slice over and over while
+//looking up all of the elements, so nodes are retired under readers
+void *churn_worker(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    for (int round = 0; round < CHURN_ROUNDS; ++round) {
+        for (size_t i = w->begin; i < w->end; ++i) {
+            w->sl->remove((*w->elements)[i].first);
+        }
+
+        for (size_t i = 0; i < w->elements->size(); ++i) {
+            int value;
+            if (w->sl->find((*w->elements)[i].first, value) && value != (*w->elements)[i].second) {
+                std::cerr << "error: find returned the wrong value...\n";
+            }
+        }
+
+        for (size_t i = w->begin; i < w->end; ++i) {
+            w->sl->insert((*w->elements)[i].first, (*w->elements)[i].second, (size_t)1 << (round%12));
+        }
+    }
+
+    return 0;
+}
+
+const int RACE_KEYS = 16;
+
+//every thread removes and reinserts the same few keys, so removes and
+//inserts of one key race with each other
+void *race_worker(void *arg)
+{
+    Worker *w = (Worker *)arg;
+    XorShiftRandom random(w->seed);
+    for (int round = 0; round < CHURN_ROUNDS * 20; ++round) {
+        for (size_t i = 0; i < RACE_KEYS; ++i) {
+            w->sl->remove((*w->elements)[i].first);
+
+            int value;
+            if (w->sl->find((*w->elements)[i].first, value) && value != (*w->elements)[i].second) {
+                std::cerr << "error: find returned the wrong value for a raced key...\n";
+            }
+
+            w->sl->insert((*w->elements)[i].first, (*w->elements)[i].second, random.next()%10);
+        }
+    }
+
+    return 0;
+}
+
+const int TEST_SIZE = 1000;
+const int STRING_SIZE = 8;
+const int THREADS = 4;
+
+void runthreadtests(Skiplist *sl, const std::vector<std::pair<std::string, int> > &elements)
+{
+    //insert from several threads at once, then find from several threads
+    std::cout << "testing threaded insert and find...\n";
+    pthread_t threads[THREADS];
+    Worker workers[THREADS];
+    for (int i = 0; i < THREADS; ++i) {
+        workers[i].sl = sl;
+        workers[i].elements = &elements;
+        workers[i].begin = i * elements.size() / THREADS;
+        workers[i].end = (i + 1) * elements.size() / THREADS;
+        workers[i].found = 0;
+        workers[i].seed = i + 1;
+        pthread_create(&threads[i], 0, insert_worker, &workers[i]);
+    }
+
+    for (int i = 0; i < THREADS; ++i) pthread_join(threads[i], 0);
+
+    for (int i = 0; i < THREADS; ++i) pthread_create(&threads[i], 0, find_worker, &workers[i]);
+
+    for (int i = 0; i < THREADS; ++i) {
+        pthread_join(threads[i], 0);
+        if (workers[i].found != elements.size()) {
+            std::cerr << "error: thread " << i << " found " << workers[i].found << " elements...\n";
+        }
+    }
+
+    //concurrent inserts, removes and finds, which should end with every
+    //element back in place
+    std::cout << "testing threaded insert, remove and find...\n";
+    for (int i = 0; i < THREADS; ++i) pthread_create(&threads[i], 0, churn_worker, &workers[i]);
+    for (int i = 0; i < THREADS; ++i) pthread_join(threads[i], 0);
+
+    //every thread ends each key with an insert, so each raced key should be
+    //present, and only once: after one remove it should be gone
+    std::cout << "testing threaded remove and insert of the same keys...\n";
+    for (int i = 0; i < THREADS; ++i) pthread_create(&threads[i], 0, race_worker, &workers[i]);
+    for (int i = 0; i < THREADS; ++i) pthread_join(threads[i], 0);
+
+    for (size_t i = 0; i < RACE_KEYS; ++i) {
+        int value;
+        if (!sl->find(elements[i].first, value) || value != elements[i].second) {
+            std::cerr << "error: raced key missing after its last insert...\n";
+        }
+
+        sl->remove(elements[i].first);
+        if (sl->find(elements[i].first, value)) {
+            std::cerr << "error: raced key inserted twice...\n";
+        }
+
+        sl->insert(elements[i].first, elements[i].second, 1);
+    }
+
+    runtests(sl, elements);
+}
+
+int main(int argc, char **argv)
+{
+    //create some elements to test against
+    std::vector<std::pair<std::string, int> > elements;
+    for (int i = 0; i < TEST_SIZE; ++i) {
+
+        //random string
+        char k[STRING_SIZE];
+        for (int j = 0; j < STRING_SIZE - 1; ++j) {
+            k[j] = (char)(96 + rand()%25);
+        }
+        k[STRING_SIZE - 1] = 0;
+
+        elements.push_back(std::make_pair<std::string, int>(k, i + 1));
+    }
+
+    Skiplist *sl = new Skiplist(20);
+    runthreadtests(sl, elements);
+    delete sl;
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/*
+Copyright (c) 2011 Daniel Minor 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+*/
+
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string> 
+#include <vector>
+
+#include "deterministic_biased_skiplist.h"
+
+template<class T> void runtests(T *sl, const std::vector<std::pair<std::string, int> > &elements)
+{
+    //try finding the elements
+    std::cout << "testing find...\n"; 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (!sl->find(elements[i].first)) {
+            std::cerr << "error: find failed to locate element...\n";
+        } 
+    }
+
+    //try finding the elements without building a std::string
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (!sl->find(elements[i].first.c_str())) {
+            std::cerr << "error: find failed to locate element by const char *...\n";
+        }
+    }
+
+    //try reweighting the elements, moving nodes between tower heights
+    std::cout << "testing reweight...\n"; 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        sl->reweight(elements[i].first, (size_t)1 << (rand()%12));
+        int *result = sl->find(elements[i].first);
+        if (!result || *result != elements[i].second) {
+            std::cerr << "error: find failed to locate reweighted element...\n";
+        } 
+    }
+
+    //removing absent keys should leave the rest alone
+    for (size_t i = 0; i < elements.size(); ++i) {
+        sl->remove(elements[i].first + "a");
+    }
+
+    //try removing half of the elements 
+    std::cout << "testing remove...\n"; 
+    size_t begin_remove_index = elements.size() / 4;
+    size_t end_remove_index = begin_remove_index + elements.size() / 2;
+
+    for (size_t i = begin_remove_index; i < end_remove_index; ++i) { 
+        sl->remove(elements[i].first);
+    } 
+
+    //try finding the elements 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        bool found = sl->find(elements[i].first) != 0;
+
+        if ((i < begin_remove_index || i >= end_remove_index) && !found) {
+            std::cerr << "error: find failed to locate element " << i << "...\n";
+        } else if (i >= begin_remove_index && i < end_remove_index && found) {
+            std::cerr << "error: find found deleted element " << i << "...\n"; 
+        } 
+    }
+}
+
+//keys inserted in order with equal weights keep splitting the same end of
+//each level, which exercises promotions, and removing runs of them merges
+//the gaps again and exercises demotions
+template<class T> void runsequentialtests(T *sl)
+{
+    std::cout << "testing sequential keys...\n"; 
+
+    const int count = 20000;
+    for (int i = 0; i < count; ++i) {
+        sl->insert(i, i + 1, 1); 
+    }
+
+    //remove most keys, keeping a few spread out heavy ones
+    for (int i = 0; i < count; ++i) {
+        if (i % 100 != 0) sl->remove(i);
+    }
+    for (int i = 0; i < count; i += 100) {
+        sl->reweight(i, 1 << 16);
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int *result = sl->find(i);
+        if (i % 100 == 0 && (!result || *result != i + 1)) {
+            std::cerr << "error: find failed to locate sequential element " << i << "...\n";
+        } else if (i % 100 != 0 && result) {
+            std::cerr << "error: find found deleted sequential element " << i << "...\n";
+        }
+    }
+
+    //and fill in around them again, in reverse
+    for (int i = count; i-- > 0;) {
+        sl->insert(i, i + 1, 1 + i % 7); 
+    }
+
+    for (int i = 0; i < count; ++i) {
+        int *result = sl->find(i);
+        if (!result || *result != i + 1) {
+            std::cerr << "error: find failed to locate reinserted element " << i << "...\n";
+        }
+    }
+}
+
+//both gap rules and the links hold after every kind of update, and every
+//search takes at most MAX_GAP + 1 steps on each level it passes through.
+//No more than 2W/2^j nodes reach level j, so a key of weight w is found
+//within about log2(W/w) + 2 levels.
+template<class T> void runinvarianttests(T *sl)
+{
+    std::cout << "testing invariants and step bound...\n"; 
+
+    std::map<int, size_t> weights;
+    for (int op = 0; op < 50000; ++op) {
+        int key = rand()%3000;
+        size_t weight = (size_t)1 << (rand()%12);
+
+        int r = rand()%10;
+        if (r < 5) {
+            if (weights.insert(std::make_pair(key, weight)).second) sl->insert(key, op, weight);
+        } else if (r < 8) {
+            sl->remove(key);
+            weights.erase(key);
+        } else if (weights.count(key)) {
+            sl->reweight(key, weight);
+            weights[key] = weight;
+        }
+
+        if (op % 1000 != 0) continue;
+
+        if (sl->check() != 0) {
+            std::cerr << "error: " << sl->check() << " broken invariants after " << op << " updates...\n";
+            return;
+        }
+
+        size_t total = 0;
+        for (std::map<int, size_t>::iterator i = weights.begin(); i != weights.end(); ++i) total += i->second;
+
+        for (std::map<int, size_t>::iterator i = weights.begin(); i != weights.end(); ++i) {
+            size_t bound = (T::MAX_GAP + 1) * (weight_level(total / i->second) + 1);
+            if (sl->steps(i->first) > bound) {
+                std::cerr << "error: search took " << sl->steps(i->first) << " steps, bound " << bound << "...\n";
+                return;
+            }
+        }
+    }
+}
+
+const unsigned int TEST_SIZE = 1000;
+const unsigned int STRING_SIZE = 8;
+
+int main(int argc, char **argv)
+{
+    //create some elements to test against
+    std::vector<std::pair<std::string, int> > elements;
+    for (size_t i = 0; i < TEST_SIZE; ++i) {
+
+        //random string
+        char k[STRING_SIZE];
+        for (size_t j = 0; j < STRING_SIZE - 1; ++j) {
+            k[j] = (char)(96 + rand()%25);
+        }
+        k[STRING_SIZE - 1] = 0;
+
+        elements.push_back(std::make_pair<std::string, int>(k, i + 1));
+    }
+
+    //do tests
+    DeterministicBiasedSkiplist<std::string, int> *sl = new DeterministicBiasedSkiplist<std::string, int>(20);
+
+    for (size_t i = 0; i < TEST_SIZE; ++i) {
+        sl->insert(elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    runtests(sl, elements); 
+
+    delete sl;
+
+    //weights beyond the level limit
+    std::cout << "testing with large weights\n";
+    sl = new DeterministicBiasedSkiplist<std::string, int>(20);
+
+    for (size_t i = 0; i < TEST_SIZE; ++i) {
+        sl->insert(elements[i].first, elements[i].second, (size_t)1 << (rand()%40)); 
+    } 
+
+    runtests(sl, elements); 
+
+    delete sl;
+
+    DeterministicBiasedSkiplist<int, int> *sequential = new DeterministicBiasedSkiplist<int, int>(20);
+    runsequentialtests(sequential);
+    if (sequential->check() != 0) std::cerr << "error: sequential updates broke invariants...\n";
+    delete sequential;
+
+    DeterministicBiasedSkiplist<int, int> *random_updates = new DeterministicBiasedSkiplist<int, int>(32);
+    runinvarianttests(random_updates);
+    delete random_updates;
+
+    //a head too short for the keys is raised as their towers are promoted,
+    //so the gaps at the top level stay short too
+    std::cout << "testing head growth...\n";
+    typedef DeterministicBiasedSkiplist<int, int> Skiplist;
+    Skiplist *short_head = new Skiplist(2);
+    for (int i = 0; i < 5000; ++i) short_head->insert(i, i + 1, 1);
+
+    if (short_head->check() != 0) {
+        std::cerr << "error: " << short_head->check() << " broken invariants under a short head...\n";
+    }
+
+    size_t bound = (Skiplist::MAX_GAP + 1) * (weight_level(5000) + 1);
+    for (int i = 0; i < 5000; ++i) {
+        if (short_head->steps(i) > bound) {
+            std::cerr << "error: search under a short head took " << short_head->steps(i) << " steps, bound " << bound << "...\n";
+            break;
+        }
+    }
+
+    delete short_head;
+
+    return 0;
+}
@@ -22,6 +22,7 @@ THE SOFTWARE.
 
 #include <cstdlib>
 #include <iostream>
+#include <stdexcept>
 #include <string> 
 #include <vector>
 
@@ -37,6 +38,13 @@ template<class T> void runtests(T *ht, const std::vector<std::pair<std::string,
         } 
     }
 
+    //try finding the elements without building a std::string
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (!ht->find(elements[i].first.c_str())) {
+            std::cerr << "error: find failed to locate element by const char *...\n";
+        }
+    }
+
     //try removing half of the elements 
     std::cout << "testing remove...\n"; 
     size_t begin_remove_index = elements.size() / 4;
@@ -58,13 +66,115 @@ template<class T> void runtests(T *ht, const std::vector<std::pair<std::string,
     }
 }
 
+//remove and reinsert random elements many times over, so removals leave
+//holes all through the table, and check every element after each round
+template<class T> void runchurntests(T *ht, const std::vector<std::pair<std::string, int> > &elements)
+{
+    std::cout << "testing remove and insert churn...\n"; 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        ht->remove(elements[i].first);
+    }
+    for (size_t i = 0; i < elements.size(); ++i) {
+        ht->insert(elements[i].first, elements[i].second, rand()%10); 
+    }
+
+    std::vector<bool> present(elements.size(), true);
+    for (int round = 0; round < 20; ++round) {
+        for (size_t i = 0; i < elements.size(); ++i) {
+            size_t j = rand()%elements.size();
+            if (present[j]) {
+                ht->remove(elements[j].first);
+            } else {
+                ht->insert(elements[j].first, elements[j].second, rand()%10); 
+            }
+            present[j] = !present[j];
+        }
+
+        for (size_t i = 0; i < elements.size(); ++i) {
+            int *result = ht->find(elements[i].first);
+            if (present[i] && (!result || *result != elements[i].second)) {
+                std::cerr << "error: find failed to locate element after churn " << i << "...\n";
+            } else if (!present[i] && result) {
+                std::cerr << "error: find found removed element after churn " << i << "...\n"; 
+            }
+        }
+    }
+}
+
+template<class T> void runbatchtests(T *ht, const std::vector<std::pair<std::string, int> > &elements)
+{
+    //try finding all of the elements in one batch
+    std::cout << "testing find_batch...\n"; 
+    std::vector<std::string> keys(elements.size());
+    std::vector<int *> results(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) keys[i] = elements[i].first;
+
+    ht->find_batch(&keys[0], keys.size(), &results[0]);
+
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (!results[i] || *results[i] != elements[i].second) {
+            std::cerr << "error: find_batch failed to locate element " << i << "...\n";
+        } 
+    }
+}
+
 const unsigned int MURMURHASH2_SEED = 0x5432FEDC;
 
 unsigned int MurmurHash2 ( const void * key, int len, unsigned int seed );
 
-unsigned int hash(const std::string &key)
+struct MurmurHash {
+    unsigned int operator()(const std::string &key) const
+    {
+        return MurmurHash2(key.c_str(), key.size(), MURMURHASH2_SEED);
+    }
+};
+
+//a value type with stricter alignment than any built in type
+struct alignas(64) CacheLine {
+    char bytes[64];
+};
+
+void runalignmenttests()
 {
-    return MurmurHash2(key.c_str(), key.size(), MURMURHASH2_SEED);
+    std::cout << "testing slab alignment...\n"; 
+    SlabAllocator<CacheLine> pool;
+    std::vector<CacheLine *> lines;
+    for (int i = 0; i < 100; ++i) lines.push_back(pool.allocate());
+
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if ((size_t)lines[i] % alignof(CacheLine) != 0) {
+            std::cerr << "error: slab allocated misaligned node...\n";
+        }
+    }
+
+    for (size_t i = 0; i < lines.size(); i += 2) pool.deallocate(lines[i]);
+}
+
+//tables built without a hash use the default KeyHash
+void rundefaulthashtests()
+{
+    std::cout << "testing default hash...\n"; 
+    BiasedHashtable<std::string, int> ht(8);
+    BiasedHashtable<int, int> iht(8);
+    for (int i = 0; i < 100; ++i) {
+        ht.insert(std::to_string(i), i, 1);
+        iht.insert(i, i, 1);
+    }
+
+    for (int i = 0; i < 100; ++i) {
+        std::string k = std::to_string(i);
+        int *v = ht.find(k);
+        if (!v || *v != i) {
+            std::cerr << "error: did not find string key with default hash...\n";
+        }
+        if (ht.find(k.c_str()) != v) {
+            std::cerr << "error: C string key hashed differently...\n";
+        }
+        v = iht.find(i);
+        if (!v || *v != i) {
+            std::cerr << "error: did not find int key with default hash...\n";
+        }
+    }
 }
 
 const int TEST_SIZE = 1000;
@@ -86,29 +196,82 @@ int main(int argc, char **argv)
         elements.push_back(std::make_pair<std::string, int>(k, i + 1));
     }
 
+    runalignmenttests();
+    rundefaulthashtests();
+
     //do tests in biased mode
     std::cout << "testing in biased mode\n";
-    BiasedHashtable<std::string, int> *ht = new BiasedHashtable<std::string, int>(8, hash);
+    BiasedHashtable<std::string, int, MurmurHash> *ht = new BiasedHashtable<std::string, int, MurmurHash>(8);
 
     //insert into the hash table 
     for (int i = 0; i < TEST_SIZE; ++i) {
         ht->insert(elements[i].first, elements[i].second, rand()%10); 
     } 
 
-    runtests<BiasedHashtable<std::string, int> >(ht, elements); 
+    runbatchtests(ht, elements);
+    runtests<BiasedHashtable<std::string, int, MurmurHash> >(ht, elements); 
 
     delete ht;
 
+    //do tests in biased mode with plain heap allocated nodes
+    std::cout << "testing in biased mode with heap allocator\n";
+    BiasedHashtable<std::string, int, MurmurHash, HeapAllocator> *hht = new BiasedHashtable<std::string, int, MurmurHash, HeapAllocator>(8);
+
+    //insert into the hash table 
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        hht->insert(elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    runtests<BiasedHashtable<std::string, int, MurmurHash, HeapAllocator> >(hht, elements); 
+
+    delete hht;
+
+    //do tests in open addressing mode
+    std::cout << "testing in open addressing mode\n";
+    RobinHoodBiasedHashtable<std::string, int, MurmurHash> *rht = new RobinHoodBiasedHashtable<std::string, int, MurmurHash>(8);
+
+    //insert into the hash table 
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        rht->insert(elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    runtests<RobinHoodBiasedHashtable<std::string, int, MurmurHash> >(rht, elements); 
+    runchurntests(rht, elements); 
+
+    delete rht;
+
+    //a full table would leave probes with no empty slot to stop at
+    try {
+        RobinHoodBiasedHashtable<std::string, int, MurmurHash> full(8, MurmurHash(), 1.0f);
+        std::cerr << "error: max_load of 1 was accepted...\n";
+    } catch (std::invalid_argument &) {
+    }
+
+    //do tests in grouped mode
+    std::cout << "testing in grouped mode\n";
+    GroupedBiasedHashtable<std::string, int, MurmurHash> *ght = new GroupedBiasedHashtable<std::string, int, MurmurHash>(8);
+
+    //insert into the hash table 
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        ght->insert(elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    runtests<GroupedBiasedHashtable<std::string, int, MurmurHash> >(ght, elements);
+    runchurntests(ght, elements); 
+
+    delete ght;
+
     //do tests in self-adjusting mode
     std::cout << "testing in self-adjusting mode\n";
-    SelfAdjustingBiasedHashtable<std::string, int> *saht = new SelfAdjustingBiasedHashtable<std::string, int>(8, hash);
+    SelfAdjustingBiasedHashtable<std::string, int, MurmurHash> *saht = new SelfAdjustingBiasedHashtable<std::string, int, MurmurHash>(8);
 
     //insert into hash table
     for (int i = 0; i < TEST_SIZE; ++i) {
         saht->insert(elements[i].first, elements[i].second);
     } 
 
-    runtests<SelfAdjustingBiasedHashtable<std::string, int> >(saht, elements); 
+    runbatchtests(saht, elements);
+    runtests<SelfAdjustingBiasedHashtable<std::string, int, MurmurHash> >(saht, elements); 
 
     delete saht;
 
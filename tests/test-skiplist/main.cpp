@@ -20,6 +20,7 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <string> 
@@ -27,7 +28,7 @@ THE SOFTWARE.
 
 #include "biased_skiplist.h"
 
-void runtests(BiasedSkiplist<std::string, int> *sl, const std::vector<std::pair<std::string, int> > &elements)
+template<class T> void runtests(T *sl, const std::vector<std::pair<std::string, int> > &elements)
 {
     //try finding the elements
     std::cout << "testing find...\n"; 
@@ -37,6 +38,28 @@ void runtests(BiasedSkiplist<std::string, int> *sl, const std::vector<std::pair<
         } 
     }
 
+    //try finding the elements without building a std::string
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (!sl->find(elements[i].first.c_str())) {
+            std::cerr << "error: find failed to locate element by const char *...\n";
+        }
+    }
+
+    //try reweighting the elements, moving nodes between tower heights
+    std::cout << "testing reweight...\n"; 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        sl->reweight(elements[i].first, (size_t)1 << (rand()%12));
+        int *result = sl->find(elements[i].first);
+        if (!result || *result != elements[i].second) {
+            std::cerr << "error: find failed to locate reweighted element...\n";
+        } 
+    }
+
+    //removing absent keys should leave the rest alone
+    for (size_t i = 0; i < elements.size(); ++i) {
+        sl->remove(elements[i].first + "a");
+    }
+
     //try removing half of the elements 
     std::cout << "testing remove...\n"; 
     size_t begin_remove_index = elements.size() / 4;
@@ -58,6 +81,72 @@ void runtests(BiasedSkiplist<std::string, int> *sl, const std::vector<std::pair<
     }
 }
 
+//insert and find in key order through a finger, then out of order and
+//after changes made without it
+template<class T> void runfingertests(T *sl, std::vector<std::pair<std::string, int> > elements)
+{
+    std::cout << "testing finger search...\n"; 
+    std::sort(elements.begin(), elements.end());
+
+    typename T::Finger finger(*sl);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        sl->insert(finger, elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int *result = sl->find(finger, elements[i].first);
+        if (!result || *result != elements[i].second) {
+            std::cerr << "error: finger find failed to locate element in order...\n";
+        } 
+    }
+
+    for (size_t i = elements.size(); i-- > 0;) {
+        int *result = sl->find(finger, elements[i].first.c_str());
+        if (!result || *result != elements[i].second) {
+            std::cerr << "error: finger find failed to locate element in reverse order...\n";
+        } 
+    }
+
+    //keys between and beyond the elements are absent
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (sl->find(finger, elements[i].first + "a")) {
+            std::cerr << "error: finger find found absent element...\n";
+        } 
+    }
+    if (sl->find(finger, "")) {
+        std::cerr << "error: finger find found absent element...\n";
+    }
+
+    //remove every other element without the finger, so it must restart
+    for (size_t i = 0; i < elements.size(); i += 2) {
+        sl->remove(elements[i].first);
+    }
+
+    for (size_t i = 0; i < elements.size(); ++i) {
+        size_t j = rand()%elements.size();
+        bool found = sl->find(finger, elements[j].first) != 0;
+        if (found != (j%2 == 1)) {
+            std::cerr << "error: finger find failed after remove...\n";
+        } 
+    }
+
+    //reinsert the removed elements through the finger, in random order
+    for (size_t i = 0; i < elements.size(); ++i) {
+        size_t j = rand()%elements.size();
+        sl->insert(finger, elements[j].first, elements[j].second, rand()%10); 
+    }
+    for (size_t i = 0; i < elements.size(); i += 2) {
+        sl->insert(finger, elements[i].first, elements[i].second, rand()%10); 
+    }
+
+    for (size_t i = 0; i < elements.size(); ++i) {
+        int *result = sl->find(elements[i].first);
+        if (!result || *result != elements[i].second) {
+            std::cerr << "error: find failed to locate element inserted by finger...\n";
+        } 
+    }
+}
+
 const unsigned int TEST_SIZE = 1000;
 const unsigned int STRING_SIZE = 8;
 
@@ -89,6 +178,95 @@ int main(int argc, char **argv)
 
     delete sl;
 
+    //with the PCG generator and weights beyond the level limit
+    std::cout << "testing with pcg random policy\n";
+    BiasedSkiplist<std::string, int, PcgRandom> *pcg = new BiasedSkiplist<std::string, int, PcgRandom>(20, 42);
+
+    for (size_t i = 0; i < TEST_SIZE; ++i) {
+        pcg->insert(elements[i].first, elements[i].second, (size_t)1 << (rand()%40)); 
+    } 
+
+    runtests(pcg, elements); 
+
+    delete pcg;
+
+    //self-adjusting, with a few keys hit often enough to be promoted while
+    //the rest cool and are demoted
+    std::cout << "testing self-adjusting version\n";
+    typedef BiasedSkiplist<std::string, int> Skiplist;
+    Skiplist *adjusting = new Skiplist(20, Skiplist::SELF_ADJUST);
+
+    for (size_t i = 0; i < TEST_SIZE; ++i) {
+        adjusting->insert(elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    for (size_t i = 0; i < 50*TEST_SIZE; ++i) {
+        size_t j = rand()%10;
+        int *result = adjusting->find(elements[j].first);
+        if (!result || *result != elements[j].second) {
+            std::cerr << "error: find failed to locate frequently accessed element...\n";
+        } 
+    }
+
+    runtests(adjusting, elements); 
+    delete adjusting;
+
+    //one key hit often grows a tall tower, which is cut back down once
+    //every other key is hit instead for many epochs
+    std::cout << "testing self-adjusting tower heights...\n";
+    adjusting = new Skiplist(20, Skiplist::SELF_ADJUST);
+    for (size_t i = 0; i < TEST_SIZE; ++i) {
+        adjusting->insert(elements[i].first, elements[i].second, 1); 
+    } 
+
+    size_t start = adjusting->height(elements[0].first);
+    for (size_t i = 0; i < 2*TEST_SIZE; ++i) adjusting->find(elements[0].first);
+
+    size_t hot = adjusting->height(elements[0].first);
+    if (hot <= start || hot < 8) {
+        std::cerr << "error: hot key's tower did not grow, height " << hot << "...\n";
+    }
+
+    for (int round = 0; round < 32; ++round) {
+        for (size_t i = 1; i < TEST_SIZE; ++i) adjusting->find(elements[i].first);
+    }
+
+    size_t cooled = adjusting->height(elements[0].first);
+    if (cooled == 0 || cooled > hot / 2) {
+        std::cerr << "error: cooled key's tower did not shrink, height " << cooled << " of " << hot << "...\n";
+    }
+
+    delete adjusting;
+
+    //keys and values smaller than the tower pointers, moved between
+    //towers as they are promoted
+    std::cout << "testing small keys...\n";
+    typedef BiasedSkiplist<int, int> IntSkiplist;
+    IntSkiplist *small = new IntSkiplist(20, IntSkiplist::SELF_ADJUST);
+    for (int i = 0; i < (int)TEST_SIZE; ++i) small->insert(i, -i, 1);
+
+    for (size_t i = 0; i < 20*TEST_SIZE; ++i) {
+        int k = i%2 ? 7 : rand()%TEST_SIZE;
+        int *result = small->find(k);
+        if (!result || *result != -k) {
+            std::cerr << "error: find failed on small key...\n";
+        }
+    }
+
+    if (small->height(7) <= 1) {
+        std::cerr << "error: small hot key's tower did not grow...\n";
+    }
+
+    delete small;
+
+    Skiplist *adjusting_finger = new Skiplist(20, Skiplist::SELF_ADJUST);
+    runfingertests(adjusting_finger, elements); 
+    delete adjusting_finger;
+
+    BiasedSkiplist<std::string, int> *fingered = new BiasedSkiplist<std::string, int>(20);
+    runfingertests(fingered, elements); 
+    delete fingered;
+
     return 0;
 }
 
@@ -20,8 +20,11 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -37,6 +40,13 @@ void runtests(SplayTree<std::string, int> *sl, const std::vector<std::pair<std::
 		}
 	}
 
+	//try finding the elements without building a std::string
+	for (size_t i = 0; i < elements.size(); ++i) {
+		if (!sl->find(elements[i].first.c_str())) {
+			std::cerr << "error: find failed to locate element by const char *...\n";
+		}
+	}
+
 	//try removing half of the elements
 	std::cout << "testing remove...\n";
 	size_t begin_remove_index = elements.size() / 4;
@@ -58,6 +68,95 @@ void runtests(SplayTree<std::string, int> *sl, const std::vector<std::pair<std::
 	}
 }
 
+//check ordered iteration and range queries against a sorted copy of the
+//elements still present
+template<class T> void runordertests(T *tree, const std::vector<std::pair<std::string, int> > &elements)
+{
+	std::cout << "testing iteration...\n"; 
+
+	std::vector<std::string> keys;
+	for (size_t i = 0; i < elements.size(); ++i) {
+		if (tree->find(elements[i].first)) keys.push_back(elements[i].first);
+	}
+	std::sort(keys.begin(), keys.end());
+
+	//forwards and backwards over the whole tree
+	size_t count = 0;
+	for (typename T::iterator i = tree->begin(); i != tree->end(); ++i) {
+		if (count >= keys.size() || i.key() != keys[count]) {
+			std::cerr << "error: iteration out of order at " << count << "...\n";
+			break;
+		}
+		++count;
+	}
+	if (count != keys.size()) std::cerr << "error: iteration missed keys...\n";
+
+	//as a standard iterator, dereferencing to the value
+	if ((size_t)std::distance(tree->begin(), tree->end()) != keys.size()) {
+		std::cerr << "error: distance from begin to end is not the key count...\n";
+	}
+	if (keys.size()) {
+		typename T::iterator j = tree->begin();
+		typename T::iterator first = j++;
+		if (first != tree->begin() || &*first != &first.value() || first.operator->() != &first.value()) {
+			std::cerr << "error: iterator does not dereference to the value...\n";
+		}
+		if (j != std::next(tree->begin()) || j-- != std::next(tree->begin()) || j != tree->begin()) {
+			std::cerr << "error: postfix increment or decrement misplaced...\n";
+		}
+	}
+
+	count = keys.size();
+	typename T::iterator i = tree->end();
+	while (count > 0) {
+		--i;
+		--count;
+		if (i.key() != keys[count]) {
+			std::cerr << "error: reverse iteration out of order at " << count << "...\n";
+			break;
+		}
+	}
+	if (keys.size() && i != tree->begin()) std::cerr << "error: reverse iteration did not reach begin...\n";
+
+	//bounds of present keys and of keys just after them
+	std::cout << "testing lower_bound and upper_bound...\n"; 
+	for (size_t k = 0; k < keys.size(); ++k) {
+		typename T::iterator lower = tree->lower_bound(keys[k]);
+		if (lower == tree->end() || lower.key() != keys[k]) {
+			std::cerr << "error: lower_bound missed present key...\n";
+		}
+
+		typename T::iterator upper = tree->upper_bound(keys[k].c_str());
+		if (k + 1 < keys.size() ? (upper == tree->end() || upper.key() != keys[k + 1]) : upper != tree->end()) {
+			std::cerr << "error: upper_bound is not the next key...\n";
+		}
+
+		lower = tree->lower_bound(keys[k] + "a");
+		if (k + 1 < keys.size() ? (lower == tree->end() || lower.key() != keys[k + 1]) : lower != tree->end()) {
+			std::cerr << "error: lower_bound of absent key is not the next key...\n";
+		}
+	}
+
+	//all keys with a given first letter
+	std::cout << "testing for_each_in_range...\n"; 
+	for (char c = 'a'; c < 'z'; ++c) {
+		std::string lo(1, c);
+		std::string hi(1, c + 1);
+
+		size_t expected = 0;
+		for (size_t k = 0; k < keys.size(); ++k) {
+			if (lo <= keys[k] && keys[k] < hi) ++expected;
+		}
+
+		std::vector<std::string> found;
+		tree->for_each_in_range(lo, hi, [&found](const std::string &key, int &) { found.push_back(key); });
+
+		if (found.size() != expected || !std::is_sorted(found.begin(), found.end())) {
+			std::cerr << "error: for_each_in_range visited the wrong keys...\n";
+		}
+	}
+}
+
 const unsigned int TEST_SIZE = 1000;
 const unsigned int STRING_SIZE = 8;
 
@@ -77,6 +176,20 @@ int main(int argc, char **argv)
 		elements.push_back(std::make_pair<std::string, int>(k, i + 1));
 	}
 
+	//distinct keys of up to 16 bytes over a small alphabet, including a byte
+	//above 127, so many keys share their first 8 bytes or are prefixes of others
+	const char alphabet[] = {'a', 'b', (char)0xe9};
+	std::set<std::string> seen;
+	std::vector<std::pair<std::string, int> > prefixed;
+	while (prefixed.size() < TEST_SIZE) {
+		std::string k(1 + rand()%16, 'a');
+		for (size_t j = 0; j < k.size(); ++j) {
+			k[j] = alphabet[rand()%3];
+		}
+
+		if (seen.insert(k).second) prefixed.push_back(std::make_pair(k, (int)prefixed.size() + 1));
+	}
+
 	//do tests
 	SplayTree<std::string, int> *st = new SplayTree<std::string, int>;
 
@@ -86,6 +199,20 @@ int main(int argc, char **argv)
 	}
 
 	runtests(st, elements);
+	runordertests(st, elements);
+
+	delete st;
+
+	//keys which often tie on their inline prefixes
+	std::cout << "testing shared prefixes\n";
+	st = new SplayTree<std::string, int>;
+
+	for (size_t i = 0; i < prefixed.size(); ++i) {
+		st->insert(prefixed[i].first, prefixed[i].second);
+	}
+
+	runtests(st, prefixed);
+	runordertests(st, prefixed);
 
 	delete st;
 
@@ -20,14 +20,19 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 THE SOFTWARE.
 */
 
+#include <algorithm>
+#include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <iterator>
+#include <set>
 #include <string> 
 #include <vector>
 
 #include "biased_treap.h"
+#include "parallel_biased_treap.h"
 
-void runtests(BiasedTreap<std::string, int> *treap, const std::vector<std::pair<std::string, int> > &elements)
+template<class T> void runtests(T *treap, const std::vector<std::pair<std::string, int> > &elements)
 {
     //try finding the elements
     std::cout << "testing find...\n"; 
@@ -37,6 +42,35 @@ void runtests(BiasedTreap<std::string, int> *treap, const std::vector<std::pair<
         } 
     }
 
+    //try finding the elements without building a std::string
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (!treap->find(elements[i].first.c_str())) {
+            std::cerr << "error: find failed to locate element by const char *...\n";
+        }
+    }
+
+    //try reweighting the elements
+    std::cout << "testing reweight...\n"; 
+    for (size_t i = 0; i < elements.size(); ++i) {
+        treap->reweight(elements[i].first, rand()%100);
+        if (!treap->find(elements[i].first)) {
+            std::cerr << "error: find failed to locate reweighted element...\n";
+        } 
+    }
+
+    //a key given a far larger weight than any other rises to the root,
+    //and sinks again once its weight is dropped to the least
+    size_t d;
+    treap->reweight(elements[0].first, (size_t)1 << 30);
+    if (!treap->depth(elements[0].first, d) || d != 0) {
+        std::cerr << "error: heavily reweighted element is not at the root...\n";
+    }
+
+    treap->reweight(elements[0].first, 1);
+    if (!treap->depth(elements[0].first, d) || d == 0) {
+        std::cerr << "error: lightly reweighted element stayed at the root...\n";
+    }
+
     //try removing half of the elements 
     std::cout << "testing remove...\n"; 
     size_t begin_remove_index = elements.size() / 4;
@@ -56,6 +90,274 @@ void runtests(BiasedTreap<std::string, int> *treap, const std::vector<std::pair<
             std::cerr << "error: find found deleted element " << i << "...\n"; 
         } 
     }
+
+    //a frozen snapshot should hold exactly the remaining elements
+    std::cout << "testing freeze...\n"; 
+    FrozenBiasedTreap<std::string, int> frozen = treap->freeze();
+
+    if (frozen.size() != elements.size() - (end_remove_index - begin_remove_index)) {
+        std::cerr << "error: frozen treap has the wrong size...\n";
+    }
+
+    for (size_t i = 0; i < elements.size(); ++i) {
+        const int *result = frozen.find(elements[i].first.c_str());
+        bool found = result && *result == elements[i].second;
+
+        if ((i < begin_remove_index || i >= end_remove_index) && !found) {
+            std::cerr << "error: frozen find failed to locate element " << i << "...\n";
+        } else if (i >= begin_remove_index && i < end_remove_index && result) {
+            std::cerr << "error: frozen find found deleted element " << i << "...\n"; 
+        } 
+    }
+}
+
+//check ordered iteration and range queries against a sorted copy of the
+//elements still present
+template<class T> void runordertests(T *tree, const std::vector<std::pair<std::string, int> > &elements)
+{
+    std::cout << "testing iteration...\n"; 
+
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (tree->find(elements[i].first)) keys.push_back(elements[i].first);
+    }
+    std::sort(keys.begin(), keys.end());
+
+    //forwards and backwards over the whole tree
+    size_t count = 0;
+    for (typename T::iterator i = tree->begin(); i != tree->end(); ++i) {
+        if (count >= keys.size() || i.key() != keys[count]) {
+            std::cerr << "error: iteration out of order at " << count << "...\n";
+            break;
+        }
+        ++count;
+    }
+    if (count != keys.size()) std::cerr << "error: iteration missed keys...\n";
+
+    //as a standard iterator, dereferencing to the value
+    if ((size_t)std::distance(tree->begin(), tree->end()) != keys.size()) {
+        std::cerr << "error: distance from begin to end is not the key count...\n";
+    }
+    if (keys.size()) {
+        typename T::iterator j = tree->begin();
+        typename T::iterator first = j++;
+        if (first != tree->begin() || &*first != &first.value() || first.operator->() != &first.value()) {
+            std::cerr << "error: iterator does not dereference to the value...\n";
+        }
+        if (j != std::next(tree->begin()) || j-- != std::next(tree->begin()) || j != tree->begin()) {
+            std::cerr << "error: postfix increment or decrement misplaced...\n";
+        }
+    }
+
+    count = keys.size();
+    typename T::iterator i = tree->end();
+    while (count > 0) {
+        --i;
+        --count;
+        if (i.key() != keys[count]) {
+            std::cerr << "error: reverse iteration out of order at " << count << "...\n";
+            break;
+        }
+    }
+    if (keys.size() && i != tree->begin()) std::cerr << "error: reverse iteration did not reach begin...\n";
+
+    //bounds of present keys and of keys just after them
+    std::cout << "testing lower_bound and upper_bound...\n"; 
+    for (size_t k = 0; k < keys.size(); ++k) {
+        typename T::iterator lower = tree->lower_bound(keys[k]);
+        if (lower == tree->end() || lower.key() != keys[k]) {
+            std::cerr << "error: lower_bound missed present key...\n";
+        }
+
+        typename T::iterator upper = tree->upper_bound(keys[k].c_str());
+        if (k + 1 < keys.size() ? (upper == tree->end() || upper.key() != keys[k + 1]) : upper != tree->end()) {
+            std::cerr << "error: upper_bound is not the next key...\n";
+        }
+
+        lower = tree->lower_bound(keys[k] + "a");
+        if (k + 1 < keys.size() ? (lower == tree->end() || lower.key() != keys[k + 1]) : lower != tree->end()) {
+            std::cerr << "error: lower_bound of absent key is not the next key...\n";
+        }
+    }
+
+    //all keys with a given first letter
+    std::cout << "testing for_each_in_range...\n"; 
+    for (char c = 'a'; c < 'z'; ++c) {
+        std::string lo(1, c);
+        std::string hi(1, c + 1);
+
+        size_t expected = 0;
+        for (size_t k = 0; k < keys.size(); ++k) {
+            if (lo <= keys[k] && keys[k] < hi) ++expected;
+        }
+
+        std::vector<std::string> found;
+        tree->for_each_in_range(lo, hi, [&found](const std::string &key, int &) { found.push_back(key); });
+
+        if (found.size() != expected || !std::is_sorted(found.begin(), found.end())) {
+            std::cerr << "error: for_each_in_range visited the wrong keys...\n";
+        }
+    }
+}
+
+bool item_less(const BiasedTreap<std::string, int>::Item &a, const BiasedTreap<std::string, int>::Item &b)
+{
+    return a.key < b.key;
+}
+
+//count the elements in [begin, end) present with the right value
+size_t count_found(BiasedTreap<std::string, int> *treap, const std::vector<std::pair<std::string, int> > &elements, size_t begin, size_t end)
+{
+    size_t found = 0;
+    for (size_t i = begin; i < end; ++i) {
+        int *result = treap->find(elements[i].first);
+        if (result && *result == elements[i].second) ++found;
+    }
+
+    return found;
+}
+
+void runsetoptests(size_t size)
+{
+    //sorted, distinct keys
+    std::vector<std::pair<std::string, int> > elements;
+    for (size_t i = 0; i < size; ++i) {
+        char k[16];
+        sprintf(k, "%08d", (int)i);
+        elements.push_back(std::make_pair<std::string, int>(k, i + 1));
+    }
+
+    std::cout << "testing split and join...\n";
+    BiasedTreap<std::string, int> *treap = new BiasedTreap<std::string, int>(false);
+    for (size_t i = 0; i < size; ++i) {
+        treap->insert(elements[i].first, elements[i].second, rand()%10);
+    }
+
+    //first between separate arenas, then within a shared one
+    BiasedTreap<std::string, int> *greater = new BiasedTreap<std::string, int>(false);
+    BiasedTreap<std::string, int> *sibling = new BiasedTreap<std::string, int>(BiasedTreap<std::string, int>::STATIC, *treap);
+    BiasedTreap<std::string, int> *targets[] = {greater, sibling};
+    for (int t = 0; t < 2; ++t) {
+        treap->split(elements[size / 3].first, *targets[t]);
+
+        if (count_found(treap, elements, 0, size / 3) != size / 3 || count_found(treap, elements, size / 3, size) != 0) {
+            std::cerr << "error: split left wrong keys behind...\n";
+        }
+        if (count_found(targets[t], elements, 0, size / 3) != 0 || count_found(targets[t], elements, size / 3, size) != size - size / 3) {
+            std::cerr << "error: split moved wrong keys...\n";
+        }
+
+        treap->join(*targets[t]);
+
+        if (count_found(treap, elements, 0, size) != size) std::cerr << "error: join lost keys...\n";
+        if (targets[t]->find(elements[size - 1].first)) std::cerr << "error: join did not empty other treap...\n";
+    }
+
+    std::cout << "testing erase_range...\n";
+    parallel_erase_range(*treap, elements[size / 4].first, elements[size / 2].first, 4);
+
+    if (count_found(treap, elements, 0, size / 4) != size / 4 || count_found(treap, elements, size / 4, size / 2) != 0 ||
+        count_found(treap, elements, size / 2, size) != size - size / 2) {
+        std::cerr << "error: erase_range removed wrong keys...\n";
+    }
+
+    std::cout << "testing union_with...\n";
+
+    //overlapping halves, the values in the first treap should win
+    BiasedTreap<std::string, int> *other = new BiasedTreap<std::string, int>(false);
+    for (size_t i = size / 8; i < size; ++i) {
+        other->insert(elements[i].first, i < size / 4 ? -1 : elements[i].second, rand()%10);
+    }
+
+    parallel_union_with(*treap, *other, 4);
+
+    if (count_found(treap, elements, 0, size) != size) std::cerr << "error: union_with produced wrong keys or values...\n";
+    if (count_found(other, elements, size / 4, size) != size - size / 4 || !other->find(elements[size / 8].first)) {
+        std::cerr << "error: union_with changed other treap...\n";
+    }
+
+    std::cout << "testing unite...\n";
+    treap->erase_range(elements[size / 2].first, elements[size - 1].first);
+    for (size_t i = size / 2; i < size; ++i) {
+        sibling->insert(elements[i].first, elements[i].second, rand()%10);
+    }
+
+    parallel_unite(*treap, *sibling, 4);
+
+    if (count_found(treap, elements, 0, size) != size) std::cerr << "error: unite produced wrong keys or values...\n";
+    if (sibling->find(elements[size - 1].first)) std::cerr << "error: unite did not empty other treap...\n";
+
+    //sequential union within the shared arena
+    treap->erase_range(elements[0].first, elements[size / 2].first);
+    for (size_t i = 0; i < size / 2; ++i) {
+        sibling->insert(elements[i].first, elements[i].second, rand()%10);
+    }
+    treap->unite(*sibling);
+
+    if (count_found(treap, elements, 0, size) != size) std::cerr << "error: unite produced wrong keys or values...\n";
+
+    delete other;
+    delete sibling;
+    delete greater;
+    delete treap;
+}
+
+//in adaptive mode a key hit often rises to the root, and sinks again once
+//other keys are hit instead
+void runadaptivetests(const std::vector<std::pair<std::string, int> > &elements)
+{
+    std::cout << "testing adaptive rise and fall...\n";
+    BiasedTreap<std::string, int> *treap = new BiasedTreap<std::string, int>(BiasedTreap<std::string, int>::ADAPTIVE);
+    for (size_t i = 0; i < elements.size(); ++i) {
+        treap->insert(elements[i].first, elements[i].second, 1);
+    }
+
+    //the deepest key
+    size_t hot = 0, d, start = 0;
+    for (size_t i = 0; i < elements.size(); ++i) {
+        if (treap->depth(elements[i].first, d) && d > start) {
+            hot = i;
+            start = d;
+        }
+    }
+
+    for (size_t i = 0; i < 2*elements.size(); ++i) treap->find(elements[hot].first);
+
+    if (!treap->depth(elements[hot].first, d) || d != 0) {
+        std::cerr << "error: hot key did not rise to the root...\n";
+    }
+
+    //enough hits on the others for many epochs to pass
+    for (int round = 0; round < 32; ++round) {
+        for (size_t i = 0; i < elements.size(); ++i) {
+            if (i != hot) treap->find(elements[i].first);
+        }
+    }
+
+    if (!treap->depth(elements[hot].first, d) || d < start / 2) {
+        std::cerr << "error: cooled key did not sink, depth " << d << " of " << start << "...\n";
+    }
+
+    delete treap;
+}
+
+//value pointers from find stay put while the treap grows
+void runstabilitytests(const std::vector<std::pair<std::string, int> > &elements)
+{
+    std::cout << "testing value pointer stability...\n";
+    BiasedTreap<std::string, int> *treap = new BiasedTreap<std::string, int>(false);
+    treap->insert(elements[0].first, elements[0].second, 1);
+    int *value = treap->find(elements[0].first);
+
+    for (size_t i = 1; i < elements.size(); ++i) {
+        treap->insert(elements[i].first, elements[i].second, rand()%10);
+    }
+
+    if (treap->find(elements[0].first) != value || *value != elements[0].second) {
+        std::cerr << "error: value moved while treap grew...\n";
+    }
+
+    delete treap;
 }
 
 const int TEST_SIZE = 1000;
@@ -77,6 +379,20 @@ int main(int argc, char **argv)
         elements.push_back(std::make_pair<std::string, int>(k, i + 1));
     }
 
+    //distinct keys of up to 16 bytes over a small alphabet, including a byte
+    //above 127, so many keys share their first 8 bytes or are prefixes of others
+    const char alphabet[] = {'a', 'b', (char)0xe9};
+    std::set<std::string> seen;
+    std::vector<std::pair<std::string, int> > prefixed;
+    while (prefixed.size() < TEST_SIZE) {
+        std::string k(1 + rand()%16, 'a');
+        for (size_t j = 0; j < k.size(); ++j) {
+            k[j] = alphabet[rand()%3];
+        }
+
+        if (seen.insert(k).second) prefixed.push_back(std::make_pair(k, (int)prefixed.size() + 1));
+    }
+
     //do tests in biased model 
     std::cout << "testing in biased mode\n";
     BiasedTreap<std::string, int> *treap = new BiasedTreap<std::string, int>(false);
@@ -87,6 +403,71 @@ int main(int argc, char **argv)
     } 
 
     runtests(treap, elements); 
+    runordertests(treap, elements);
+
+    delete treap;
+
+    //do tests on a bulk built treap
+    std::cout << "testing bulk build\n";
+    treap = new BiasedTreap<std::string, int>(false);
+
+    std::vector<BiasedTreap<std::string, int>::Item> items;
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        BiasedTreap<std::string, int>::Item item = {elements[i].first, elements[i].second, (size_t)(rand()%10)};
+        items.push_back(item);
+    }
+    std::sort(items.begin(), items.end(), item_less);
+
+    treap->build(items.begin(), items.end());
+
+    runtests(treap, elements);
+    runordertests(treap, elements);
+
+    delete treap;
+
+    //keys which often tie on their inline prefixes
+    std::cout << "testing shared prefixes\n";
+    treap = new BiasedTreap<std::string, int>(false);
+
+    for (size_t i = 0; i < prefixed.size(); ++i) {
+        treap->insert(prefixed[i].first, prefixed[i].second, rand()%10); 
+    } 
+
+    runtests(treap, prefixed);
+    runordertests(treap, prefixed);
+
+    delete treap;
+
+    runstabilitytests(elements);
+    runadaptivetests(elements);
+
+    //large enough for the parallel paths to be taken
+    runsetoptests(100000);
+
+    //do tests with the PCG generator
+    std::cout << "testing with pcg random policy\n";
+    BiasedTreap<std::string, int, PcgRandom> *pcg = new BiasedTreap<std::string, int, PcgRandom>(false, 42);
+
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        pcg->insert(elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    runtests(pcg, elements);
+    runordertests(pcg, elements);
+
+    delete pcg;
+
+    //do tests in adaptive mode
+    std::cout << "testing in adaptive mode\n";
+    treap = new BiasedTreap<std::string, int>(BiasedTreap<std::string, int>::ADAPTIVE);
+
+    //insert into treap 
+    for (int i = 0; i < TEST_SIZE; ++i) {
+        treap->insert(elements[i].first, elements[i].second, rand()%10); 
+    } 
+
+    runtests(treap, elements);
+    runordertests(treap, elements);
 
     delete treap;
 
@@ -100,6 +481,7 @@ int main(int argc, char **argv)
     } 
 
     runtests(treap, elements);
+    runordertests(treap, elements);
 
     delete treap;
 